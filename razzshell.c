@@ -30,6 +30,15 @@
 #include "src/posix_compat.h"
 #include "src/undo.h"
 #include "src/object_pipeline.h"
+#include "src/tree_copy.h"
+#include "src/file_view.h"
+#include "src/text_search.h"
+#include "src/file_search.h"
+#include "src/disk_usage.h"
+#include "src/dir_list.h"
+#include "src/word_count.h"
+#include "src/out_sink.h"
+#include "src/proc_scan.h"
 
 #define MAX_ARGS 128
 #define MAX_JOBS 100
@@ -149,13 +158,9 @@ int razz_viewjobs(char **args);     // jobs
 int razz_bringtofront(char **args); // fg
 int razz_sendtoback(char **args);   // bg
 int razz_terminate(char **args);    // kill
-int razz_list(char **args);         // ls
 int razz_copy(char **args);         // cp
 int razz_move(char **args);         // mv
 int razz_delete(char **args);       // rm
-int razz_searchfile(char **args);   // find
-int razz_readfile(char **args);     // cat
-int razz_searchtext(char **args);   // grep
 int razz_commands(char **args);     // history
 int razz_create(char **args);       // touch
 int razz_makedir(char **args);      // mkdir
@@ -186,11 +191,7 @@ int razz_clear(char **args);        // clear screen
 int razz_today(char **args);        // date
 int razz_calendar(char **args);     // cal
 int razz_diskfree(char **args);     // df
-int razz_diskuse(char **args);      // du
 int razz_systemname(char **args);   // uname
-int razz_headfile(char **args);     // head
-int razz_tailfile(char **args);     // tail
-int razz_wordcount(char **args);    // wc
 int razz_aliases(char **args);      // list aliases
 int razz_unsetenv(char **args);     // unset environment variable
 int razz_repeat(char **args);       // repeat command
@@ -287,217 +288,6 @@ CommandMap command_list[] = {
     // Add additional commands here as per your list
 };
 
-// File type icons for list command
-#define ICON_DIRECTORY "📁"
-#define ICON_FILE "📄"
-#define ICON_EXECUTABLE "⚡"
-#define ICON_IMAGE "🖼️"
-#define ICON_VIDEO "🎥"
-#define ICON_AUDIO "🎵"
-#define ICON_ARCHIVE "📦"
-#define ICON_TEXT "📝"
-#define ICON_PDF "📕"
-#define ICON_CONFIG "⚙️"
-#define ICON_LINK "🔗"
-
-// Function to get file icon based on extension and permissions
-const char* get_file_icon(const char* name, mode_t mode) {
-    if (S_ISDIR(mode)) return ICON_DIRECTORY;
-    if (S_ISLNK(mode)) return ICON_LINK;
-    if (mode & S_IXUSR) return ICON_EXECUTABLE;
-
-    // Get file extension
-    const char* ext = strrchr(name, '.');
-    if (!ext) return ICON_FILE;
-    ext++; // Skip the dot
-
-    // Common file extensions
-    if (strcasecmp(ext, "jpg") == 0 || strcasecmp(ext, "png") == 0 || 
-        strcasecmp(ext, "gif") == 0 || strcasecmp(ext, "bmp") == 0)
-        return ICON_IMAGE;
-    if (strcasecmp(ext, "mp4") == 0 || strcasecmp(ext, "avi") == 0 || 
-        strcasecmp(ext, "mkv") == 0)
-        return ICON_VIDEO;
-    if (strcasecmp(ext, "mp3") == 0 || strcasecmp(ext, "wav") == 0 || 
-        strcasecmp(ext, "flac") == 0)
-        return ICON_AUDIO;
-    if (strcasecmp(ext, "zip") == 0 || strcasecmp(ext, "tar") == 0 || 
-        strcasecmp(ext, "gz") == 0)
-        return ICON_ARCHIVE;
-    if (strcasecmp(ext, "txt") == 0 || strcasecmp(ext, "md") == 0 || 
-        strcasecmp(ext, "c") == 0 || strcasecmp(ext, "cpp") == 0 || 
-        strcasecmp(ext, "py") == 0 || strcasecmp(ext, "js") == 0)
-        return ICON_TEXT;
-    if (strcasecmp(ext, "pdf") == 0)
-        return ICON_PDF;
-    if (strcasecmp(ext, "conf") == 0 || strcasecmp(ext, "config") == 0 || 
-        strcasecmp(ext, "ini") == 0)
-        return ICON_CONFIG;
-
-    return ICON_FILE;
-}
-
-// Format size in human-readable format
-char* format_size(off_t size) {
-    static char buf[32];
-    const char* units[] = {"B", "K", "M", "G", "T"};
-    int unit = 0;
-    double size_d = size;
-
-    while (size_d >= 1024 && unit < 4) {
-        size_d /= 1024;
-        unit++;
-    }
-
-    if (unit == 0)
-        sprintf(buf, "%ld%s", (long)size_d, units[unit]);
-    else
-        sprintf(buf, "%.1f%s", size_d, units[unit]);
-
-    return buf;
-}
-
-// Format permissions in a readable format
-char* format_permissions(mode_t mode) {
-    static char perms[11];
-    strcpy(perms, "----------");
-
-    // File type
-    if (S_ISDIR(mode)) perms[0] = 'd';
-    else if (S_ISLNK(mode)) perms[0] = 'l';
-
-    // User permissions
-    if (mode & S_IRUSR) perms[1] = 'r';
-    if (mode & S_IWUSR) perms[2] = 'w';
-    if (mode & S_IXUSR) perms[3] = 'x';
-
-    // Group permissions
-    if (mode & S_IRGRP) perms[4] = 'r';
-    if (mode & S_IWGRP) perms[5] = 'w';
-    if (mode & S_IXGRP) perms[6] = 'x';
-
-    // Others permissions
-    if (mode & S_IROTH) perms[7] = 'r';
-    if (mode & S_IWOTH) perms[8] = 'w';
-    if (mode & S_IXOTH) perms[9] = 'x';
-
-    return perms;
-}
-
-// Improved list command with better organization and visuals
-int razz_list(char **args) {
-    DIR *dir;
-    struct dirent *entry;
-    struct stat file_stat;
-    char path[PATH_MAX];
-    char datestr[256];
-    struct passwd *pw;
-    struct group *gr;
-    
-    // Get target directory
-    const char *target_dir = args[1] ? args[1] : ".";
-    
-    dir = opendir(target_dir);
-    if (!dir) {
-        printf(ERROR_STYLE "Error: Could not open directory %s\n" RESET_COLOR, target_dir);
-        return 1;
-    }
-
-    // Print header with fancy border
-    printf(CYBER_STYLE "\n╭──────────────────────────────────────────────────────────────╮\n");
-    printf("│ " BOLD_TEXT "Directory Listing: %-43s" RESET_COLOR CYBER_STYLE "│\n", target_dir);
-    printf("├──────────────────────────────────────────────────────────────┤\n" RESET_COLOR);
-    
-    printf(BOLD_TEXT "%-2s %-10s %-8s %-8s %-6s %-19s %s\n" RESET_COLOR,
-           "", "Perms", "Owner", "Group", "Size", "Modified", "Name");
-    printf(DIM_TEXT "%-2s %-10s %-8s %-8s %-6s %-19s %s\n" RESET_COLOR,
-           "", "----------", "--------", "--------", "------", "-------------------", "--------------------");
-
-    // Store entries for sorting
-    typedef struct file_entry {
-        char name[256];
-        char perms[11];
-        char owner[32];
-        char group[32];
-        char size[32];
-        char date[64];
-        char icon[8];
-        int is_dir;
-    } FileEntry;
-
-    FileEntry entries[1024];
-    int entry_count = 0;
-
-    // Read directory entries
-    while ((entry = readdir(dir)) != NULL && entry_count < 1024) {
-        snprintf(path, sizeof(path), "%s/%s", target_dir, entry->d_name);
-        
-        if (lstat(path, &file_stat) < 0)
-            continue;
-
-        // Skip hidden files unless -a flag is present
-        if (entry->d_name[0] == '.' && (!args[1] || strcmp(args[1], "-a") != 0))
-            continue;
-
-        // Get owner and group names
-        pw = getpwuid(file_stat.st_uid);
-        gr = getgrgid(file_stat.st_gid);
-
-        // Format modification time
-        strftime(datestr, sizeof(datestr), "%Y-%m-%d %H:%M", localtime(&file_stat.st_mtime));
-
-        // Store entry information
-        FileEntry *current = &entries[entry_count];
-        strncpy(current->name, entry->d_name, sizeof(current->name) - 1);
-        strncpy(current->perms, format_permissions(file_stat.st_mode), sizeof(current->perms) - 1);
-        strncpy(current->owner, pw ? pw->pw_name : "unknown", sizeof(current->owner) - 1);
-        strncpy(current->group, gr ? gr->gr_name : "unknown", sizeof(current->group) - 1);
-        strncpy(current->size, format_size(file_stat.st_size), sizeof(current->size) - 1);
-        strncpy(current->date, datestr, sizeof(current->date) - 1);
-        strncpy(current->icon, get_file_icon(entry->d_name, file_stat.st_mode), sizeof(current->icon) - 1);
-        current->is_dir = S_ISDIR(file_stat.st_mode);
-
-        entry_count++;
-    }
-
-    // Sort entries (directories first, then files alphabetically)
-    for (int i = 0; i < entry_count - 1; i++) {
-        for (int j = 0; j < entry_count - i - 1; j++) {
-            if ((entries[j].is_dir < entries[j + 1].is_dir) ||
-                (entries[j].is_dir == entries[j + 1].is_dir && 
-                 strcasecmp(entries[j].name, entries[j + 1].name) > 0)) {
-                FileEntry temp = entries[j];
-                entries[j] = entries[j + 1];
-                entries[j + 1] = temp;
-            }
-        }
-    }
-
-    // Print entries with alternating background colors for better readability
-    for (int i = 0; i < entry_count; i++) {
-        const char *bg_color = (i % 2 == 0) ? "" : BG_CYBER;
-        if (entries[i].is_dir) {
-            printf("%s%-2s " BLUE_COLOR "%-10s %-8s %-8s %-6s %-19s %s%s" RESET_COLOR "\n",
-                   bg_color, entries[i].icon, entries[i].perms, entries[i].owner,
-                   entries[i].group, entries[i].size, entries[i].date, 
-                   entries[i].name, S_ISLNK(file_stat.st_mode) ? " -> " : "");
-        } else {
-            printf("%s%-2s %-10s %-8s %-8s %-6s %-19s %s%s" RESET_COLOR "\n",
-                   bg_color, entries[i].icon, entries[i].perms, entries[i].owner,
-                   entries[i].group, entries[i].size, entries[i].date, 
-                   entries[i].name, S_ISLNK(file_stat.st_mode) ? " -> " : "");
-        }
-    }
-
-    // Print footer with summary
-    printf(CYBER_STYLE "├──────────────────────────────────────────────────────────────┤\n");
-    printf("│ " BOLD_TEXT "Total: %d items" RESET_COLOR CYBER_STYLE "%-43s│\n", entry_count, "");
-    printf("╰──────────────────────────────────────────────────────────────╯\n" RESET_COLOR);
-    
-    closedir(dir);
-    return 1;
-}
-
 // Enhanced RazzFetch with better visuals
 int razz_fetch(char **args) {
     struct utsname sys_info;
@@ -847,7 +637,7 @@ char **razzshell_completion(const char *text, int start, int end) {
 }
 
 // Function prototype for highlighting commands
-void highlight_command(const char *cmd, const char *highlight);
+void highlight_command(OutSink *out, const char *cmd, const char *highlight);
 
 // Command implementations
 int razz_change(char **args) {
@@ -1001,45 +791,75 @@ int razz_terminate(char **args) {
     return 1;
 }
 
-int razz_copy(char **args) {
-    if (args[1] == NULL || args[2] == NULL) {
-        fprintf(stderr, "Usage: copy [source] [destination]\n");
+// Resolve where src ends up: copying/moving into an existing directory targets dir/basename(src)
+static void resolve_destination(const char *src, const char *dst, char *out, size_t size) {
+    struct stat st;
+    if (stat(dst, &st) == 0 && S_ISDIR(st.st_mode)) {
+        char src_copy[PATH_MAX];
+        strncpy(src_copy, src, sizeof(src_copy) - 1);
+        src_copy[sizeof(src_copy) - 1] = '\0';
+        // Drop trailing slashes so "dir/" still yields "dir"
+        size_t len = strlen(src_copy);
+        while (len > 1 && src_copy[len - 1] == '/') src_copy[--len] = '\0';
+        const char *base = strrchr(src_copy, '/');
+        base = base ? base + 1 : src_copy;
+        snprintf(out, size, "%s/%s", dst, base);
     } else {
-        pid_t pid = fork();
-        if (pid == 0) {
-            execlp("cp", "cp", args[1], args[2], NULL);
-            perror("copy");
-            exit(EXIT_FAILURE);
-        } else if (pid > 0) {
-            int status;
-            waitpid(pid, &status, 0);
-            if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
-                undo_log_copy(args[2]);
-            }
-        } else {
-            perror("fork");
+        snprintf(out, size, "%s", dst);
+    }
+}
+
+// Collect non-flag operands; returns the operand count
+static int collect_operands(char **args, char **operands, int max) {
+    int count = 0;
+    for (int i = 1; args[i] != NULL && count < max; i++) {
+        if (args[i][0] == '-' && args[i][1] != '\0') continue; // -r, -R, -v ... are implied
+        operands[count++] = args[i];
+    }
+    return count;
+}
+
+int razz_copy(char **args) {
+    char *operands[MAX_ARGS];
+    int count = collect_operands(args, operands, MAX_ARGS);
+    if (count < 2) {
+        fprintf(stderr, "Usage: copy [source...] [destination]\n");
+        return 1;
+    }
+
+    const char *dst = operands[count - 1];
+    for (int i = 0; i < count - 1; i++) {
+        char target[PATH_MAX];
+        resolve_destination(operands[i], dst, target, sizeof(target));
+        if (tree_copy(operands[i], target) == 0) {
+            // One journal entry covers the whole copied tree
+            undo_log_copy(target);
         }
     }
     return 1;
 }
 
 int razz_move(char **args) {
-    if (args[1] == NULL || args[2] == NULL) {
-        fprintf(stderr, "Usage: move [source] [destination]\n");
-    } else {
-        pid_t pid = fork();
-        if (pid == 0) {
-            execlp("mv", "mv", args[1], args[2], NULL);
-            perror("move");
-            exit(EXIT_FAILURE);
-        } else if (pid > 0) {
-            int status;
-            waitpid(pid, &status, 0);
-            if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
-                undo_log_move(args[1], args[2]);
-            }
+    char *operands[MAX_ARGS];
+    int count = collect_operands(args, operands, MAX_ARGS);
+    if (count < 2) {
+        fprintf(stderr, "Usage: move [source...] [destination]\n");
+        return 1;
+    }
+
+    const char *dst = operands[count - 1];
+    for (int i = 0; i < count - 1; i++) {
+        char target[PATH_MAX];
+        char abs_src[PATH_MAX];
+        resolve_destination(operands[i], dst, target, sizeof(target));
+        // Resolve before moving; the source path stops existing afterwards
+        if (realpath(operands[i], abs_src) == NULL) {
+            snprintf(abs_src, sizeof(abs_src), "%s", operands[i]);
+        }
+        if (tree_move(operands[i], target) == 0) {
+            undo_log_move(abs_src, target);
         } else {
-            perror("fork");
+            fprintf(stderr, "move: %s: %s\n", operands[i], strerror(errno));
         }
     }
     return 1;
@@ -1070,64 +890,13 @@ int razz_delete(char **args) {
     return 1;
 }
 
-int razz_searchfile(char **args) {
-    if (args[1] == NULL) {
-        fprintf(stderr, "Usage: searchfile [filename]\n");
-    } else {
-        pid_t pid = fork();
-        if (pid == 0) {
-            execvp("find", args);
-            perror("searchfile");
-            exit(EXIT_FAILURE);
-        } else if (pid > 0) {
-            waitpid(pid, NULL, 0);
-        } else {
-            perror("fork");
-        }
-    }
-    return 1;
-}
-
-int razz_readfile(char **args) {
-    if (args[1] == NULL) {
-        fprintf(stderr, "Usage: readfile [filename]\n");
-    } else {
-        pid_t pid = fork();
-        if (pid == 0) {
-            execvp("cat", args);
-            perror("readfile");
-            exit(EXIT_FAILURE);
-        } else if (pid > 0) {
-            waitpid(pid, NULL, 0);
-        } else {
-            perror("fork");
-        }
-    }
-    return 1;
-}
-
-int razz_searchtext(char **args) {
-    if (args[1] == NULL || args[2] == NULL) {
-        fprintf(stderr, "Usage: searchtext [pattern] [file]\n");
-    } else {
-        pid_t pid = fork();
-        if (pid == 0) {
-            execvp("grep", args);
-            perror("searchtext");
-            exit(EXIT_FAILURE);
-        } else if (pid > 0) {
-            waitpid(pid, NULL, 0);
-        } else {
-            perror("fork");
-        }
-    }
-    return 1;
-}
-
 int razz_commands(char **args) {
+    OutSink out;
+    out_sink_open(&out, STDOUT_FILENO);
     for (int i = 0; i < history_count; i++) {
-        printf("%d %s\n", i + 1, history[i]);
+        out_sink_printf(&out, "%d %s\n", i + 1, history[i]);
     }
+    out_sink_close(&out);
     return 1;
 }
 
@@ -1239,17 +1008,54 @@ int razz_setowner(char **args) {
     return 1;
 }
 
+// Native equivalent of ps -ef; any other ps options are passed to the system ps
 int razz_showprocesses(char **args) {
-    pid_t pid = fork();
-    if (pid == 0) {
-        execlp("ps", "ps", "-ef", NULL);
-        perror("showprocesses");
-        exit(EXIT_FAILURE);
-    } else if (pid > 0) {
-        waitpid(pid, NULL, 0);
-    } else {
-        perror("fork");
+    ProcTable table;
+    if (args[1] != NULL || proc_scan(&table, PROC_FIELD_ALL) != 0) {
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0) {
+            if (args[1] != NULL) execvp("ps", args);
+            else execlp("ps", "ps", "-ef", NULL);
+            perror("showprocesses");
+            exit(EXIT_FAILURE);
+        } else if (pid > 0) {
+            waitpid(pid, NULL, 0);
+        } else {
+            perror("fork");
+        }
+        return 1;
     }
+
+    OutSink out;
+    out_sink_open(&out, STDOUT_FILENO);
+    out_sink_printf(&out, "%-8s %7s %7s %2s %5s %-8s %8s %s\n",
+                    "UID", "PID", "PPID", "C", "STIME", "TTY", "TIME", "CMD");
+
+    time_t now = time(NULL);
+    struct tm today;
+    localtime_r(&now, &today);
+    for (size_t i = 0; i < table.count && !out.failed; i++) {
+        const ProcRecord *p = &table.procs[i];
+        struct tm tm;
+        char stime[16], tty[16];
+        localtime_r(&p->start_time, &tm);
+        // Like ps: time of day for processes started today, otherwise the date
+        int same_day = tm.tm_year == today.tm_year && tm.tm_yday == today.tm_yday;
+        strftime(stime, sizeof(stime), same_day ? "%H:%M" : "%b%d", &tm);
+        proc_tty_name(p->tty_nr, tty, sizeof(tty));
+        unsigned long long secs = p->cpu_ticks / (unsigned long long)table.ticks_per_sec;
+
+        out_sink_printf(&out, "%-8s %7d %7d %2d %5s %-8s %02llu:%02llu:%02llu ",
+                        proc_user_name(p->uid), (int)p->pid, (int)p->ppid, (int)p->cpu_percent,
+                        stime, tty, secs / 3600, (secs / 60) % 60, secs % 60);
+        // Kernel threads have no command line and are shown as [name]
+        if (p->cmdline) out_sink_printf(&out, "%s\n", p->cmdline);
+        else out_sink_printf(&out, "[%s]\n", p->name);
+    }
+
+    out_sink_close(&out);
+    proc_table_free(&table);
     return 1;
 }
 
@@ -1630,20 +1436,6 @@ int razz_diskfree(char **args) {
     return 1;
 }
 
-int razz_diskuse(char **args) {
-    pid_t pid = fork();
-    if (pid == 0) {
-        execvp("du", args);
-        perror("diskuse");
-        exit(EXIT_FAILURE);
-    } else if (pid > 0) {
-        waitpid(pid, NULL, 0);
-    } else {
-        perror("fork");
-    }
-    return 1;
-}
-
 int razz_systemname(char **args) {
     pid_t pid = fork();
     if (pid == 0) {
@@ -1658,60 +1450,6 @@ int razz_systemname(char **args) {
     return 1;
 }
 
-int razz_headfile(char **args) {
-    if (args[1] == NULL) {
-        printf("Usage: headfile [filename]\n");
-        return 1;
-    }
-    pid_t pid = fork();
-    if (pid == 0) {
-        execvp("head", args);
-        perror("headfile");
-        exit(EXIT_FAILURE);
-    } else if (pid > 0) {
-        waitpid(pid, NULL, 0);
-    } else {
-        perror("fork");
-    }
-    return 1;
-}
-
-int razz_tailfile(char **args) {
-    if (args[1] == NULL) {
-        printf("Usage: tailfile [filename]\n");
-        return 1;
-    }
-    pid_t pid = fork();
-    if (pid == 0) {
-        execvp("tail", args);
-        perror("tailfile");
-        exit(EXIT_FAILURE);
-    } else if (pid > 0) {
-        waitpid(pid, NULL, 0);
-    } else {
-        perror("fork");
-    }
-    return 1;
-}
-
-int razz_wordcount(char **args) {
-    if (args[1] == NULL) {
-        printf("Usage: wordcount [filename]\n");
-        return 1;
-    }
-    pid_t pid = fork();
-    if (pid == 0) {
-        execvp("wc", args);
-        perror("wordcount");
-        exit(EXIT_FAILURE);
-    } else if (pid > 0) {
-        waitpid(pid, NULL, 0);
-    } else {
-        perror("fork");
-    }
-    return 1;
-}
-
 int razz_repeat(char **args) {
     if (args[1] == NULL || args[2] == NULL) {
         printf("Usage: repeat [count] [command]\n");
@@ -1807,11 +1545,19 @@ int razz_monitor(char **args) {
         if (interval < 1) interval = 1;
     }
 
-    printf(NEON_CYAN "╭───────────────────── " NEON_PINK "Process Monitor" NEON_CYAN " ─────────────────────╮\n" RESET_COLOR);
+    // Each frame is built in the sink and reaches the terminal in one write
+    OutSink out;
+    out_sink_open(&out, STDOUT_FILENO);
+
+    ProcTable prev_procs;
+    double prev_at = 0.0;
+    int have_prev = 0;
+
+    out_sink_printf(&out, NEON_CYAN "╭───────────────────── " NEON_PINK "Process Monitor" NEON_CYAN " ─────────────────────╮\n" RESET_COLOR);
     
     while (1) {
         // Clear previous output
-        printf("\033[H\033[J");
+        out_sink_printf(&out, "\033[H\033[J");
         
         // Get CPU usage
         double cpu_usage = 0.0;
@@ -1853,66 +1599,90 @@ int razz_monitor(char **args) {
         char timestr[64];
         strftime(timestr, sizeof(timestr), "%H:%M:%S", localtime(&now));
         
-        printf(NEON_CYAN "│ " NEON_YELLOW "System Monitor" NEON_CYAN " - Updated at: " 
+        out_sink_printf(&out, NEON_CYAN "│ " NEON_YELLOW "System Monitor" NEON_CYAN " - Updated at: " 
                NEON_GREEN "%s" NEON_CYAN " │\n", timestr);
-        printf("├────────────────────────────────────────────────────────┤\n" RESET_COLOR);
+        out_sink_printf(&out, "├────────────────────────────────────────────────────────┤\n" RESET_COLOR);
 
         // CPU Usage Bar
-        printf(NEON_CYAN "│ " NEON_BLUE "CPU Usage  " RESET_COLOR "[");
+        out_sink_printf(&out, NEON_CYAN "│ " NEON_BLUE "CPU Usage  " RESET_COLOR "[");
         int cpu_bars = (int)(cpu_usage / 2.5);
         for (int i = 0; i < 40; i++) {
             if (i < cpu_bars)
-                printf(NEON_GREEN "█");
+                out_sink_puts(&out, NEON_GREEN "█");
             else
-                printf(DIM_TEXT "░" RESET_COLOR);
+                out_sink_puts(&out, DIM_TEXT "░" RESET_COLOR);
         }
-        printf("] %5.1f%%" NEON_CYAN " │\n", cpu_usage);
+        out_sink_printf(&out, "] %5.1f%%" NEON_CYAN " │\n", cpu_usage);
 
         // Memory Usage Bar
         double mem_used = (total_mem - available_mem) / 1024.0;
         double mem_total = total_mem / 1024.0;
         double mem_percent = (mem_used / mem_total) * 100;
         
-        printf(NEON_CYAN "│ " NEON_PINK "Memory    " RESET_COLOR "[");
+        out_sink_printf(&out, NEON_CYAN "│ " NEON_PINK "Memory    " RESET_COLOR "[");
         int mem_bars = (int)(mem_percent / 2.5);
         for (int i = 0; i < 40; i++) {
             if (i < mem_bars)
-                printf(NEON_ORANGE "█");
+                out_sink_puts(&out, NEON_ORANGE "█");
             else
-                printf(DIM_TEXT "░" RESET_COLOR);
+                out_sink_puts(&out, DIM_TEXT "░" RESET_COLOR);
         }
-        printf("] %5.1f%%" NEON_CYAN " │\n", mem_percent);
-        printf("│ " RESET_COLOR "          %.1f/%.1f GB Used" NEON_CYAN "%27s│\n", 
+        out_sink_printf(&out, "] %5.1f%%" NEON_CYAN " │\n", mem_percent);
+        out_sink_printf(&out, "│ " RESET_COLOR "          %.1f/%.1f GB Used" NEON_CYAN "%27s│\n", 
                mem_used/1024.0, mem_total/1024.0, "");
 
         // Top processes
-        printf("├────────────────────────────────────────────────────────┤\n");
-        printf("│ " NEON_GREEN "Top Processes by CPU Usage" NEON_CYAN "%29s│\n", "");
-        printf("├────────────────────────────────────────────────────────┤\n");
-        printf("│ " NEON_BLUE "PID   CPU%%   MEM%%   COMMAND" NEON_CYAN "%35s│\n", "");
-
-        // Get top processes using ps command
-        FILE *ps = popen("ps -eo pid,pcpu,pmem,comm --sort=-pcpu | head -n 6", "r");
-        if (ps) {
-            char line[256];
-            int count = 0;
-            // Skip header
-            fgets(line, sizeof(line), ps);
-            while (fgets(line, sizeof(line), ps) && count < 5) {
-                int pid;
-                float cpu, mem;
-                char cmd[32];
-                sscanf(line, "%d %f %f %s", &pid, &cpu, &mem, cmd);
-                printf(NEON_CYAN "│ " RESET_COLOR "%5d %5.1f %6.1f   %-30s" NEON_CYAN "│\n",
-                       pid, cpu, mem, cmd);
-                count++;
+        out_sink_printf(&out, "├────────────────────────────────────────────────────────┤\n");
+        out_sink_printf(&out, "│ " NEON_GREEN "Top Processes by CPU Usage" NEON_CYAN "%29s│\n", "");
+        out_sink_printf(&out, "├────────────────────────────────────────────────────────┤\n");
+        out_sink_printf(&out, "│ " NEON_BLUE "PID   CPU%%   MEM%%   COMMAND" NEON_CYAN "%35s│\n", "");
+
+        // Top processes: CPU over the last interval, from two /proc scans
+        ProcTable procs;
+        if (proc_scan(&procs, PROC_FIELD_NAME | PROC_FIELD_STAT) == 0) {
+            struct timespec scan_ts;
+            clock_gettime(CLOCK_MONOTONIC, &scan_ts);
+            double scan_at = scan_ts.tv_sec + scan_ts.tv_nsec / 1e9;
+            double elapsed = have_prev ? scan_at - prev_at : 0.0;
+
+            const ProcRecord *top[5] = { NULL };
+            double top_cpu[5] = { 0 };
+            for (size_t i = 0; i < procs.count; i++) {
+                const ProcRecord *p = &procs.procs[i];
+                // The first frame has nothing to diff against, so use the lifetime average
+                double cpu = p->cpu_percent;
+                if (elapsed > 0) {
+                    const ProcRecord *old = proc_table_find(&prev_procs, p->pid);
+                    unsigned long long before = old && old->start_ticks == p->start_ticks ? old->cpu_ticks : 0;
+                    cpu = 100.0 * (double)(p->cpu_ticks - before) / procs.ticks_per_sec / elapsed;
+                }
+                for (int k = 0; k < 5; k++) {
+                    if (!top[k] || cpu > top_cpu[k]) {
+                        for (int m = 4; m > k; m--) {
+                            top[m] = top[m - 1];
+                            top_cpu[m] = top_cpu[m - 1];
+                        }
+                        top[k] = p;
+                        top_cpu[k] = cpu;
+                        break;
+                    }
+                }
+            }
+            for (int k = 0; k < 5 && top[k]; k++) {
+                double mem = procs.total_mem_kb ? 100.0 * top[k]->rss_kb / procs.total_mem_kb : 0.0;
+                out_sink_printf(&out, NEON_CYAN "│ " RESET_COLOR "%5d %5.1f %6.1f   %-30s" NEON_CYAN "│\n",
+                       (int)top[k]->pid, top_cpu[k], mem, top[k]->name);
             }
-            pclose(ps);
+
+            if (have_prev) proc_table_free(&prev_procs);
+            prev_procs = procs;
+            prev_at = scan_at;
+            have_prev = 1;
         }
 
-        printf("╰────────────────────────────────────────────────────────╯\n" RESET_COLOR);
+        out_sink_printf(&out, "╰────────────────────────────────────────────────────────╯\n" RESET_COLOR);
         
-        fflush(stdout);
+        out_sink_flush(&out);
         sleep(interval);
 
         // Check for input to exit
@@ -1929,7 +1699,9 @@ int razz_monitor(char **args) {
     }
 
     // Clear screen when exiting
-    printf("\033[2J\033[H");
+    out_sink_printf(&out, "\033[2J\033[H");
+    out_sink_close(&out);
+    if (have_prev) proc_table_free(&prev_procs);
     return 1;
 }
 
@@ -1943,50 +1715,53 @@ int razz_history_search(char **args) {
 
     char *query = args[1];
     int found = 0;
+    OutSink out;
+    out_sink_open(&out, STDOUT_FILENO);
 
-    printf(NEON_CYAN "╭─────────────────── " NEON_PINK "Command History Search" 
+    out_sink_printf(&out, NEON_CYAN "╭─────────────────── " NEON_PINK "Command History Search" 
            NEON_CYAN " ───────────────────╮\n");
 
     if (query) {
         // Search mode
-        printf("│ " NEON_YELLOW "Searching for: " RESET_COLOR "%-43s" NEON_CYAN "│\n", query);
-        printf("├────────────────────────────────────────────────────────┤\n");
+        out_sink_printf(&out, "│ " NEON_YELLOW "Searching for: " RESET_COLOR "%-43s" NEON_CYAN "│\n", query);
+        out_sink_printf(&out, "├────────────────────────────────────────────────────────┤\n");
         
         for (int i = 0; history[i]; i++) {
             if (strcasestr(history[i]->line, query)) {
-                highlight_command(history[i]->line, query);
+                highlight_command(&out, history[i]->line, query);
                 found++;
             }
         }
         
         if (!found) {
-            printf("%s│ %sNo matches found for: %s%s%*s│\n", 
+            out_sink_printf(&out, "%s│ %sNo matches found for: %s%s%*s│\n", 
                    NEON_CYAN, NEON_RED, query, NEON_CYAN,
                    (int)(35 - strlen(query)), "");
         }
     } else {
         // Show recent history with line numbers
-        printf("│ " NEON_YELLOW "Recent Commands" NEON_CYAN "%41s│\n", "");
-        printf("├────────────────────────────────────────────────────────┤\n");
+        out_sink_printf(&out, "│ " NEON_YELLOW "Recent Commands" NEON_CYAN "%41s│\n", "");
+        out_sink_printf(&out, "├────────────────────────────────────────────────────────┤\n");
         
         int start = history_length - 10;
         if (start < 0) start = 0;
         
         for (int i = start; history[i]; i++) {
-            printf("│ " NEON_GREEN "%3d" RESET_COLOR " │ ", i + 1);
-            highlight_command(history[i]->line, NULL);
+            out_sink_printf(&out, "│ " NEON_GREEN "%3d" RESET_COLOR " │ ", i + 1);
+            highlight_command(&out, history[i]->line, NULL);
             found++;
         }
     }
 
-    printf("╰────────────────────────────────────────────────────────╯\n");
-    printf(RESET_COLOR "Type '!<number>' to execute a command or 'q' to quit\n");
-    
+    out_sink_printf(&out, "╰────────────────────────────────────────────────────────╯\n");
+    out_sink_printf(&out, RESET_COLOR "Type '!<number>' to execute a command or 'q' to quit\n");
+    out_sink_close(&out);
+
     return 1;
 }
 
 // Syntax highlighting for commands
-void highlight_command(const char *cmd, const char *highlight) {
+void highlight_command(OutSink *out, const char *cmd, const char *highlight) {
     char *cmd_copy = strdup(cmd);
     char *token = strtok(cmd_copy, " ");
     int first = 1;
@@ -1995,29 +1770,29 @@ void highlight_command(const char *cmd, const char *highlight) {
     while (token) {
         // Add spacing
         if (!first) {
-            printf(" ");
+            out_sink_puts(out, " ");
             pos++;
         }
 
         // Highlight matching text if searching
         if (highlight && strcasestr(token, highlight)) {
-            printf(NEON_PINK "%s" RESET_COLOR, token);
+            out_sink_printf(out, NEON_PINK "%s" RESET_COLOR, token);
         }
         // Highlight command name
         else if (first) {
-            printf(NEON_BLUE "%s" RESET_COLOR, token);
+            out_sink_printf(out, NEON_BLUE "%s" RESET_COLOR, token);
         }
         // Highlight options
         else if (token[0] == '-') {
-            printf(NEON_GREEN "%s" RESET_COLOR, token);
+            out_sink_printf(out, NEON_GREEN "%s" RESET_COLOR, token);
         }
         // Highlight paths
         else if (strchr(token, '/')) {
-            printf(NEON_YELLOW "%s" RESET_COLOR, token);
+            out_sink_printf(out, NEON_YELLOW "%s" RESET_COLOR, token);
         }
         // Regular text
         else {
-            printf("%s", token);
+            out_sink_puts(out, token);
         }
 
         pos += strlen(token);
@@ -2028,9 +1803,9 @@ void highlight_command(const char *cmd, const char *highlight) {
     // Pad to full width
     int padding = 48 - pos;
     if (padding > 0) {
-        printf("%*s", padding, "");
+        out_sink_printf(out, "%*s", padding, "");
     }
-    printf(NEON_CYAN "│\n");
+    out_sink_printf(out, NEON_CYAN "│\n");
 
     free(cmd_copy);
 }
@@ -2420,6 +2195,66 @@ void init_shell() {
     }
 }
 
+// Split one pipeline stage into args, applying POSIX translation and aliases
+static int tokenize_stage(char *stage_cmd, char **args) {
+    int arg_count = 0;
+    char *arg_token = strtok(stage_cmd, " \t\r\n");
+    while (arg_token != NULL && arg_count < MAX_ARGS - 1) {
+        const char *translated = posix_translate_command(arg_token);
+        char *alias_cmd = check_alias((char*)translated);
+        args[arg_count++] = alias_cmd;
+        arg_token = strtok(NULL, " \t\r\n");
+    }
+    args[arg_count] = NULL;
+    return arg_count;
+}
+
+static int (*find_builtin(const char *name))(char **) {
+    for (size_t k = 0; k < sizeof(command_list) / sizeof(CommandMap); k++) {
+        if (strcmp(name, command_list[k].command_name) == 0) {
+            return command_list[k].command_func;
+        }
+    }
+    return NULL;
+}
+
+// Builtin sources that can feed a pipeline from inside the shell process,
+// so the first stage costs no fork. They write straight to the pipe through
+// raw writes or an OutSink, never through stdio.
+static const char *inprocess_sources[] = {
+    "readfile",
+    "headfile",
+    "tailfile",
+    "searchfile",
+    "processes",
+    "commands",
+    NULL
+};
+
+static int is_inprocess_source(const char *name) {
+    for (int i = 0; inprocess_sources[i] != NULL; i++) {
+        if (strcmp(name, inprocess_sources[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+// Run a builtin in the shell with stdout pointed at out_fd
+static void run_inprocess_stage(int (*func)(char **), char **args, int out_fd) {
+    fflush(stdout);
+    int saved_stdout = dup(STDOUT_FILENO);
+    dup2(out_fd, STDOUT_FILENO);
+
+    // A reader that exits early must not take the shell down with SIGPIPE
+    void (*old_sigpipe)(int) = signal(SIGPIPE, SIG_IGN);
+    func(args);
+    fflush(stdout);
+    clearerr(stdout);
+    signal(SIGPIPE, old_sigpipe);
+
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+}
+
 int execute_pipeline(char *cmd_line) {
     char *stages[16];
     int num_stages = 0;
@@ -2441,8 +2276,18 @@ int execute_pipeline(char *cmd_line) {
             return 1;
         }
     }
+
+    // Decide up front whether the source stage runs inside the shell
+    char *source_cmd = strdup(stages[0]);
+    char *source_args[MAX_ARGS];
+    int (*source_func)(char **) = NULL;
+    if (num_stages > 1 && tokenize_stage(source_cmd, source_args) > 0 &&
+        is_inprocess_source(source_args[0])) {
+        source_func = find_builtin(source_args[0]);
+    }
+    int first_forked = source_func ? 1 : 0;
     
-    for (int i = 0; i < num_stages; i++) {
+    for (int i = first_forked; i < num_stages; i++) {
         pids[i] = fork();
         if (pids[i] == 0) {
             if (i > 0) {
@@ -2459,30 +2304,16 @@ int execute_pipeline(char *cmd_line) {
             
             char *stage_cmd = strdup(stages[i]);
             char *args[MAX_ARGS];
-            int arg_count = 0;
-            char *arg_token = strtok(stage_cmd, " \t\r\n");
-            while (arg_token != NULL && arg_count < MAX_ARGS - 1) {
-                const char *translated = posix_translate_command(arg_token);
-                char *alias_cmd = check_alias((char*)translated);
-                args[arg_count++] = alias_cmd;
-                arg_token = strtok(NULL, " \t\r\n");
-            }
-            args[arg_count] = NULL;
+            tokenize_stage(stage_cmd, args);
             
             if (args[0] == NULL) {
                 exit(0);
             }
             
-            int found = 0;
-            for (int k = 0; k < sizeof(command_list) / sizeof(CommandMap); k++) {
-                if (strcmp(args[0], command_list[k].command_name) == 0) {
-                    command_list[k].command_func(args);
-                    found = 1;
-                    break;
-                }
-            }
-            
-            if (!found) {
+            int (*func)(char **) = find_builtin(args[0]);
+            if (func) {
+                func(args);
+            } else {
                 execvp(args[0], args);
                 fprintf(stderr, "%s: command not found\n", args[0]);
                 exit(EXIT_FAILURE);
@@ -2491,20 +2322,34 @@ int execute_pipeline(char *cmd_line) {
             exit(EXIT_SUCCESS);
         } else if (pids[i] < 0) {
             perror("fork");
+            free(source_cmd);
             free(line_cp);
             return 1;
         }
     }
-    
-    for (int i = 0; i < num_stages - 1; i++) {
-        close(pipes[i][0]);
-        close(pipes[i][1]);
+
+    if (source_func) {
+        // Keep only the write end of the first pipe; it closes after the source finishes
+        int out_fd = pipes[0][1];
+        close(pipes[0][0]);
+        for (int i = 1; i < num_stages - 1; i++) {
+            close(pipes[i][0]);
+            close(pipes[i][1]);
+        }
+        run_inprocess_stage(source_func, source_args, out_fd);
+        close(out_fd);
+    } else {
+        for (int i = 0; i < num_stages - 1; i++) {
+            close(pipes[i][0]);
+            close(pipes[i][1]);
+        }
     }
     
-    for (int i = 0; i < num_stages; i++) {
+    for (int i = first_forked; i < num_stages; i++) {
         waitpid(pids[i], NULL, 0);
     }
     
+    free(source_cmd);
     free(line_cp);
     return 1;
 }
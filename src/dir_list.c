@@ -0,0 +1,538 @@
+#define _GNU_SOURCE
+#include "dir_list.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <time.h>
+#include <pwd.h>
+#include <grp.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <signal.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "thread_pool.h"
+#include "out_sink.h"
+
+#define GETDENTS_BUF_SIZE (256 * 1024)
+#define ARENA_BLOCK_SIZE  (1024 * 1024)
+#define ID_CACHE_SLOTS    256
+#define STAT_BATCH        32
+#define STAT_THREADS      16      // statx is I/O bound on network filesystems
+#define DEFAULT_DEADLINE_MS 3000
+#define WAIT_SLICE_MS     50
+
+// Theme colours, as used by the rest of the shell
+#define RESET_COLOR   "\x1b[0m"
+#define BLUE_COLOR    "\x1b[38;5;33m"
+#define RED_COLOR     "\x1b[38;5;196m"
+#define PURPLE_COLOR  "\x1b[38;5;93m"
+#define BOLD_TEXT     "\x1b[1m"
+#define DIM_TEXT      "\x1b[2m"
+#define BG_CYBER      "\x1b[48;5;17m"
+#define ERROR_STYLE   BOLD_TEXT RED_COLOR
+#define CYBER_STYLE   BOLD_TEXT PURPLE_COLOR BG_CYBER
+
+// File type icons
+#define ICON_DIRECTORY "📁"
+#define ICON_FILE "📄"
+#define ICON_EXECUTABLE "⚡"
+#define ICON_IMAGE "🖼️"
+#define ICON_VIDEO "🎥"
+#define ICON_AUDIO "🎵"
+#define ICON_ARCHIVE "📦"
+#define ICON_TEXT "📝"
+#define ICON_PDF "📕"
+#define ICON_CONFIG "⚙️"
+#define ICON_LINK "🔗"
+
+// Record layout returned by getdents64(2)
+struct linux_dirent64 {
+    ino_t d_ino;
+    off_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+// Bump allocator for names; freed all at once when the listing is done
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t used;
+    size_t cap;
+    char data[];
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock *head;
+} Arena;
+
+typedef struct {
+    const char *name;
+    char *link_target;         // symlinks only
+    unsigned char d_type;      // from getdents64; enough to sort directories first
+    mode_t mode;
+    uid_t uid;
+    gid_t gid;
+    off_t size;
+    time_t mtime;
+} ListEntry;
+
+// Entries are stat'ed by pool workers in fixed-size batches. The job is
+// refcounted so a listing can give up on a hung filesystem and return while
+// workers are still blocked in statx; whoever drops the last reference frees it.
+typedef struct {
+    atomic_int refs;
+    atomic_int cancel;
+    int dirfd;
+    Arena names;
+    ListEntry *entries;
+    size_t count;
+    size_t nbatches;
+    atomic_size_t next_batch;
+
+    pthread_mutex_t lock;
+    pthread_cond_t progress;
+    unsigned char *batch_done;   // guarded by lock
+} StatJob;
+
+typedef struct {
+    unsigned id;
+    const char *name;   // NULL for an empty slot
+} IdSlot;
+
+typedef struct {
+    IdSlot users[ID_CACHE_SLOTS];
+    IdSlot groups[ID_CACHE_SLOTS];
+    time_t last_minute;
+    char last_date[32];
+} NameCache;
+
+static char* arena_alloc(Arena *a, size_t n) {
+    if (!a->head || a->head->cap - a->head->used < n) {
+        size_t cap = n > ARENA_BLOCK_SIZE ? n : ARENA_BLOCK_SIZE;
+        ArenaBlock *b = malloc(sizeof(ArenaBlock) + cap);
+        if (!b) return NULL;
+        b->next = a->head;
+        b->used = 0;
+        b->cap = cap;
+        a->head = b;
+    }
+    char *p = a->head->data + a->head->used;
+    a->head->used += n;
+    return p;
+}
+
+static const char* arena_strndup(Arena *a, const char *s, size_t len) {
+    char *p = arena_alloc(a, len + 1);
+    if (!p) return NULL;
+    memcpy(p, s, len);
+    p[len] = '\0';
+    return p;
+}
+
+static void arena_free(Arena *a) {
+    while (a->head) {
+        ArenaBlock *next = a->head->next;
+        free(a->head);
+        a->head = next;
+    }
+}
+
+static const char* cached_name(IdSlot *slots, unsigned id, int is_group, Arena *arena) {
+    unsigned slot = (id * 2654435761u) % ID_CACHE_SLOTS;
+    for (int probe = 0; probe < ID_CACHE_SLOTS; probe++) {
+        IdSlot *s = &slots[(slot + probe) % ID_CACHE_SLOTS];
+        if (s->name && s->id == id) return s->name;
+        if (!s->name) {
+            const char *found = NULL;
+            if (is_group) {
+                struct group *gr = getgrgid(id);
+                if (gr) found = gr->gr_name;
+            } else {
+                struct passwd *pw = getpwuid(id);
+                if (pw) found = pw->pw_name;
+            }
+            s->id = id;
+            s->name = arena_strndup(arena, found ? found : "unknown", strlen(found ? found : "unknown"));
+            return s->name ? s->name : "unknown";
+        }
+    }
+    return "unknown";
+}
+
+// Function to get file icon based on extension and permissions
+static const char* file_icon(const char *name, mode_t mode) {
+    if (S_ISDIR(mode)) return ICON_DIRECTORY;
+    if (S_ISLNK(mode)) return ICON_LINK;
+    if (mode & S_IXUSR) return ICON_EXECUTABLE;
+
+    const char *ext = strrchr(name, '.');
+    if (!ext) return ICON_FILE;
+    ext++;
+
+    if (strcasecmp(ext, "jpg") == 0 || strcasecmp(ext, "png") == 0 ||
+        strcasecmp(ext, "gif") == 0 || strcasecmp(ext, "bmp") == 0)
+        return ICON_IMAGE;
+    if (strcasecmp(ext, "mp4") == 0 || strcasecmp(ext, "avi") == 0 ||
+        strcasecmp(ext, "mkv") == 0)
+        return ICON_VIDEO;
+    if (strcasecmp(ext, "mp3") == 0 || strcasecmp(ext, "wav") == 0 ||
+        strcasecmp(ext, "flac") == 0)
+        return ICON_AUDIO;
+    if (strcasecmp(ext, "zip") == 0 || strcasecmp(ext, "tar") == 0 ||
+        strcasecmp(ext, "gz") == 0)
+        return ICON_ARCHIVE;
+    if (strcasecmp(ext, "txt") == 0 || strcasecmp(ext, "md") == 0 ||
+        strcasecmp(ext, "c") == 0 || strcasecmp(ext, "cpp") == 0 ||
+        strcasecmp(ext, "py") == 0 || strcasecmp(ext, "js") == 0)
+        return ICON_TEXT;
+    if (strcasecmp(ext, "pdf") == 0)
+        return ICON_PDF;
+    if (strcasecmp(ext, "conf") == 0 || strcasecmp(ext, "config") == 0 ||
+        strcasecmp(ext, "ini") == 0)
+        return ICON_CONFIG;
+
+    return ICON_FILE;
+}
+
+static void format_permissions(mode_t mode, char perms[11]) {
+    memcpy(perms, "----------", 11);
+    if (S_ISDIR(mode)) perms[0] = 'd';
+    else if (S_ISLNK(mode)) perms[0] = 'l';
+    if (mode & S_IRUSR) perms[1] = 'r';
+    if (mode & S_IWUSR) perms[2] = 'w';
+    if (mode & S_IXUSR) perms[3] = 'x';
+    if (mode & S_IRGRP) perms[4] = 'r';
+    if (mode & S_IWGRP) perms[5] = 'w';
+    if (mode & S_IXGRP) perms[6] = 'x';
+    if (mode & S_IROTH) perms[7] = 'r';
+    if (mode & S_IWOTH) perms[8] = 'w';
+    if (mode & S_IXOTH) perms[9] = 'x';
+}
+
+static void format_size(off_t size, char *buf, size_t len) {
+    const char *units[] = {"B", "K", "M", "G", "T"};
+    int unit = 0;
+    double size_d = (double)size;
+    while (size_d >= 1024 && unit < 4) {
+        size_d /= 1024;
+        unit++;
+    }
+    if (unit == 0) snprintf(buf, len, "%ld%s", (long)size_d, units[unit]);
+    else snprintf(buf, len, "%.1f%s", size_d, units[unit]);
+}
+
+// Most entries of a directory share a handful of minutes, so keep the last one
+static const char* format_mtime(NameCache *cache, time_t mtime) {
+    time_t minute = mtime / 60;
+    if (minute != cache->last_minute || cache->last_date[0] == '\0') {
+        struct tm tm;
+        localtime_r(&mtime, &tm);
+        strftime(cache->last_date, sizeof(cache->last_date), "%Y-%m-%d %H:%M", &tm);
+        cache->last_minute = minute;
+    }
+    return cache->last_date;
+}
+
+// Stat one entry with just the fields the table shows
+static int stat_entry(int dirfd, ListEntry *e) {
+    struct statx stx;
+    if (statx(dirfd, e->name, AT_SYMLINK_NOFOLLOW,
+              STATX_TYPE | STATX_MODE | STATX_UID | STATX_GID | STATX_SIZE | STATX_MTIME, &stx) != 0) {
+        return -1;
+    }
+    e->mode = stx.stx_mode;
+    e->uid = stx.stx_uid;
+    e->gid = stx.stx_gid;
+    e->size = (off_t)stx.stx_size;
+    e->mtime = stx.stx_mtime.tv_sec;
+    if (S_ISLNK(e->mode)) {
+        char target[PATH_MAX];
+        ssize_t n = readlinkat(dirfd, e->name, target, sizeof(target) - 1);
+        if (n >= 0) e->link_target = strndup(target, (size_t)n);
+    }
+    return 0;
+}
+
+static void stat_job_release(StatJob *job) {
+    if (atomic_fetch_sub(&job->refs, 1) != 1) return;
+    for (size_t i = 0; i < job->count; i++) free(job->entries[i].link_target);
+    free(job->entries);
+    free(job->batch_done);
+    arena_free(&job->names);
+    pthread_mutex_destroy(&job->lock);
+    pthread_cond_destroy(&job->progress);
+    close(job->dirfd);
+    free(job);
+}
+
+// Pool task: claim batches in order until none are left or the listing gave up
+static void stat_worker(void *arg) {
+    StatJob *job = arg;
+    for (;;) {
+        if (atomic_load(&job->cancel)) break;
+        size_t b = atomic_fetch_add(&job->next_batch, 1);
+        if (b >= job->nbatches) break;
+
+        size_t end = (b + 1) * STAT_BATCH;
+        if (end > job->count) end = job->count;
+        int ok = 1;
+        for (size_t i = b * STAT_BATCH; i < end; i++) {
+            if (atomic_load(&job->cancel)) {
+                ok = 0;
+                break;
+            }
+            // An entry that vanished or cannot be stat'ed is shown with '?'
+            if (stat_entry(job->dirfd, &job->entries[i]) != 0) job->entries[i].mode = 0;
+        }
+
+        pthread_mutex_lock(&job->lock);
+        if (ok) job->batch_done[b] = 1;
+        pthread_cond_broadcast(&job->progress);
+        pthread_mutex_unlock(&job->lock);
+    }
+    stat_job_release(job);
+}
+
+static ThreadPool* stat_pool(void) {
+    // Shared by every listing for the life of the shell, so a worker stuck on
+    // a dead mount never holds up the prompt
+    static ThreadPool *pool = NULL;
+    if (!pool) pool = thread_pool_create(STAT_THREADS, STAT_THREADS * 4);
+    return pool;
+}
+
+static volatile sig_atomic_t list_interrupted = 0;
+
+static void list_sigint(int signo) {
+    (void)signo;
+    list_interrupted = 1;
+}
+
+static void format_row(OutSink *out, const ListEntry *e, size_t index, int have_stat,
+                       NameCache *names, Arena *arena) {
+    const char *bg_color = (index % 2 == 0) ? "" : BG_CYBER;
+    if (!have_stat || e->mode == 0) {
+        // Metadata did not arrive before the deadline
+        mode_t mode = DTTOIF(e->d_type);
+        out_sink_printf(out, "%s%-2s %s%-10s %-8s %-8s %-6s %-19s %s" RESET_COLOR "\n",
+                   bg_color, file_icon(e->name, mode), S_ISDIR(mode) ? BLUE_COLOR : "",
+                   "?", "?", "?", "?", "?", e->name);
+        return;
+    }
+
+    char perms[11];
+    char size[32];
+    format_permissions(e->mode, perms);
+    format_size(e->size, size, sizeof(size));
+    const char *owner = cached_name(names->users, e->uid, 0, arena);
+    const char *group = cached_name(names->groups, e->gid, 1, arena);
+    const char *arrow = e->link_target ? " -> " : "";
+    const char *target = e->link_target ? e->link_target : "";
+
+    out_sink_printf(out, "%s%-2s %s%-10s %-8s %-8s %-6s %-19s %s%s%s" RESET_COLOR "\n",
+               bg_color, file_icon(e->name, e->mode), S_ISDIR(e->mode) ? BLUE_COLOR : "",
+               perms, owner, group, size, format_mtime(names, e->mtime), e->name, arrow, target);
+}
+
+// Directories first, then names case-insensitively. Uses d_type so the order
+// is known before any stat has returned.
+static int compare_entries(const void *a, const void *b) {
+    const ListEntry *x = a;
+    const ListEntry *y = b;
+    int xd = x->d_type == DT_DIR, yd = y->d_type == DT_DIR;
+    if (xd != yd) return yd - xd;
+    return strcasecmp(x->name, y->name);
+}
+
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Read every name in the directory into the job
+static int read_names(StatJob *job, int show_hidden) {
+    char *dents = malloc(GETDENTS_BUF_SIZE);
+    if (!dents) return -1;
+    size_t cap = 0;
+    long nread;
+    while ((nread = syscall(SYS_getdents64, job->dirfd, dents, GETDENTS_BUF_SIZE)) > 0) {
+        for (long off = 0; off < nread; ) {
+            struct linux_dirent64 *d = (struct linux_dirent64 *)(dents + off);
+            off += d->d_reclen;
+            // Hidden entries are dropped before they cost a stat
+            if (d->d_name[0] == '.' && !show_hidden) continue;
+
+            if (job->count == cap) {
+                size_t ncap = cap ? cap * 2 : 1024;
+                ListEntry *grown = realloc(job->entries, ncap * sizeof(ListEntry));
+                if (!grown) {
+                    free(dents);
+                    return -1;
+                }
+                job->entries = grown;
+                cap = ncap;
+            }
+            ListEntry *e = &job->entries[job->count];
+            memset(e, 0, sizeof(ListEntry));
+            e->name = arena_strndup(&job->names, d->d_name, strlen(d->d_name));
+            e->d_type = d->d_type;
+            if (e->name) job->count++;
+        }
+    }
+    free(dents);
+    return 0;
+}
+
+int razz_list(char **args) {
+    const char *target_dir = ".";
+    int show_hidden = 0;
+    int stream = 0;
+    long long deadline_ms = DEFAULT_DEADLINE_MS;
+    for (int i = 1; args[i] != NULL; i++) {
+        if (strcmp(args[i], "-a") == 0) show_hidden = 1;
+        else if (strcmp(args[i], "--stream") == 0) stream = 1;
+        else if (strcmp(args[i], "--deadline") == 0 && args[i + 1]) deadline_ms = atoll(args[++i]);
+        else target_dir = args[i];
+    }
+
+    int dirfd = open(target_dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    StatJob *job = dirfd >= 0 ? calloc(1, sizeof(StatJob)) : NULL;
+    if (!job) {
+        if (dirfd >= 0) close(dirfd);
+        printf(ERROR_STYLE "Error: Could not open directory %s\n" RESET_COLOR, target_dir);
+        return 1;
+    }
+    job->dirfd = dirfd;
+    atomic_init(&job->refs, 1);
+    atomic_init(&job->cancel, 0);
+    atomic_init(&job->next_batch, 0);
+    pthread_mutex_init(&job->lock, NULL);
+    pthread_cond_init(&job->progress, NULL);
+
+    Arena arena = { NULL };
+    OutSink out;
+    NameCache *names = calloc(1, sizeof(NameCache));
+
+    if (names && read_names(job, show_hidden) == 0) {
+        if (!stream) qsort(job->entries, job->count, sizeof(ListEntry), compare_entries);
+        job->nbatches = (job->count + STAT_BATCH - 1) / STAT_BATCH;
+        job->batch_done = calloc(job->nbatches ? job->nbatches : 1, 1);
+    }
+    if (!names || !job->batch_done) {
+        printf(ERROR_STYLE "Error: Could not read directory %s\n" RESET_COLOR, target_dir);
+        free(names);
+        stat_job_release(job);
+        return 1;
+    }
+
+    // Start one claiming worker per pool thread; a full pool just means fewer
+    ThreadPool *pool = stat_pool();
+    size_t workers = job->nbatches < STAT_THREADS ? job->nbatches : STAT_THREADS;
+    for (size_t i = 0; pool && i < workers; i++) {
+        atomic_fetch_add(&job->refs, 1);
+        if (!thread_pool_try_submit(pool, stat_worker, job)) {
+            atomic_fetch_sub(&job->refs, 1);
+            break;
+        }
+    }
+
+    out_sink_open(&out, STDOUT_FILENO);
+    out_sink_printf(&out, CYBER_STYLE "\n╭──────────────────────────────────────────────────────────────╮\n");
+    out_sink_printf(&out, "│ " BOLD_TEXT "Directory Listing: %-43s" RESET_COLOR CYBER_STYLE "│\n", target_dir);
+    out_sink_printf(&out, "├──────────────────────────────────────────────────────────────┤\n" RESET_COLOR);
+    out_sink_printf(&out, BOLD_TEXT "%-2s %-10s %-8s %-8s %-6s %-19s %s\n" RESET_COLOR,
+               "", "Perms", "Owner", "Group", "Size", "Modified", "Name");
+    out_sink_printf(&out, DIM_TEXT "%-2s %-10s %-8s %-8s %-6s %-19s %s\n" RESET_COLOR,
+               "", "----------", "--------", "--------", "------", "-------------------", "--------------------");
+
+    struct sigaction sa, old_sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = list_sigint;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, &old_sa);
+    list_interrupted = 0;
+
+    // Print batches as their stats land: in order when sorted, in completion
+    // order with --stream. Rows are formatted without the lock held, since
+    // the sink may write when its buffer fills; a finished batch never changes.
+    unsigned char *printed = calloc(job->nbatches ? job->nbatches : 1, 1);
+    size_t rows = 0, batches_printed = 0, next = 0;
+    long long deadline = now_ms() + deadline_ms;
+    pthread_mutex_lock(&job->lock);
+    while (printed && batches_printed < job->nbatches) {
+        int progressed = 0;
+        for (size_t b = stream ? 0 : next; b < job->nbatches; b++) {
+            if (printed[b]) continue;
+            if (!job->batch_done[b]) {
+                if (!stream) break;
+                continue;
+            }
+            pthread_mutex_unlock(&job->lock);
+            size_t end = (b + 1) * STAT_BATCH < job->count ? (b + 1) * STAT_BATCH : job->count;
+            for (size_t i = b * STAT_BATCH; i < end; i++) {
+                format_row(&out, &job->entries[i], rows++, 1, names, &arena);
+            }
+            pthread_mutex_lock(&job->lock);
+            printed[b] = 1;
+            batches_printed++;
+            progressed = 1;
+            if (!stream) next = b + 1;
+        }
+        if (progressed || batches_printed == job->nbatches) continue;
+        if (list_interrupted || now_ms() >= deadline) break;
+
+        // About to wait: show what we have so far
+        pthread_mutex_unlock(&job->lock);
+        out_sink_flush(&out);
+        pthread_mutex_lock(&job->lock);
+
+        long long wait = deadline - now_ms();
+        if (wait > WAIT_SLICE_MS) wait = WAIT_SLICE_MS;
+        if (wait > 0) {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_nsec += (long)(wait * 1000000);
+            ts.tv_sec += ts.tv_nsec / 1000000000;
+            ts.tv_nsec %= 1000000000;
+            pthread_cond_timedwait(&job->progress, &job->lock, &ts);
+        }
+    }
+    pthread_mutex_unlock(&job->lock);
+    sigaction(SIGINT, &old_sa, NULL);
+
+    // Whatever is still outstanding is abandoned and shown without metadata
+    atomic_store(&job->cancel, 1);
+    size_t missing = 0;
+    for (size_t b = 0; printed && b < job->nbatches; b++) {
+        if (printed[b]) continue;
+        size_t end = (b + 1) * STAT_BATCH < job->count ? (b + 1) * STAT_BATCH : job->count;
+        for (size_t i = b * STAT_BATCH; i < end; i++) {
+            format_row(&out, &job->entries[i], rows++, 0, names, &arena);
+            missing++;
+        }
+    }
+
+    out_sink_printf(&out, CYBER_STYLE "├──────────────────────────────────────────────────────────────┤\n");
+    out_sink_printf(&out, "│ " BOLD_TEXT "Total: %zu items" RESET_COLOR CYBER_STYLE "%-43s│\n", rows, "");
+    out_sink_printf(&out, "╰──────────────────────────────────────────────────────────────╯\n" RESET_COLOR);
+    out_sink_close(&out);
+    if (missing > 0) {
+        fprintf(stderr, "list: %s for %zu entries of %s, shown as '?'\n",
+                list_interrupted ? "interrupted" : "metadata timed out", missing, target_dir);
+    }
+
+    free(printed);
+    free(names);
+    arena_free(&arena);
+    stat_job_release(job);
+    return 1;
+}
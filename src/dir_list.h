@@ -0,0 +1,13 @@
+#ifndef DIR_LIST_H
+#define DIR_LIST_H
+
+// Command: list (ls)
+// list [-a] [--stream] [--deadline MS] [directory]
+// Reads the directory with getdents64 into an arena (no entry limit) and
+// sorts directories first then by name. Entries are stat'ed concurrently on a
+// shared pool with only the fields shown; rows are printed as results arrive
+// (in completion order with --stream). Metadata still missing at the deadline
+// (3 s by default) or after Ctrl-C is shown as '?'.
+int razz_list(char **args);
+
+#endif // DIR_LIST_H
@@ -0,0 +1,623 @@
+#define _GNU_SOURCE
+#include "disk_usage.h"
+#include "fs_walk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/wait.h>
+
+#define CACHE_MAGIC "# razzshell ducache v1"
+
+typedef struct {
+    unsigned long long blocks;   // 512-byte units, as in st_blocks
+    unsigned long long bytes;    // apparent size
+    unsigned long long files;
+} DuTotals;
+
+// A file with more than one link; counted once no matter how often it is seen
+typedef struct {
+    dev_t dev;
+    ino_t ino;
+    unsigned long long blocks;
+    unsigned long long bytes;
+} LinkedFile;
+
+// What a directory looked like last time: its identity, the totals of its
+// single-link entries and the list of its multi-link entries
+typedef struct {
+    char *path;
+    dev_t dev;
+    ino_t ino;
+    long long mtime_sec, ctime_sec;
+    unsigned mtime_nsec, ctime_nsec;
+    DuTotals direct;
+    LinkedFile *links;
+    size_t nlinks;
+    int seen;   // superseded by this run
+} CacheRecord;
+
+typedef struct {
+    CacheRecord *records;
+    size_t count;
+    size_t cap;
+    size_t *slots;    // record index + 1, 0 when empty
+    size_t nslots;
+} DuCache;
+
+typedef struct DuNode {
+    struct DuNode *parent;
+    char *path;               // absolute
+    int root;                 // index into the roots being walked
+    int depth;
+    dev_t dev;
+    ino_t ino;
+    long long mtime_sec, ctime_sec;
+    unsigned mtime_nsec, ctime_nsec;
+    const CacheRecord *cached;
+
+    DuTotals own;             // the directory inode itself
+    DuTotals direct;          // single-link entries, from the listing or the cache
+    DuTotals linked;          // multi-link entries this directory saw first
+    LinkedFile *links;
+    size_t nlinks;
+    size_t links_cap;
+    DuTotals children;        // finished subdirectories, guarded by the job lock
+    DuTotals total;
+} DuNode;
+
+typedef struct {
+    int summarize;
+    int human;
+    int grand_total;
+    int table;
+    int use_cache;            // trust cached subtotals of unchanged directories
+    int save_cache;
+    int max_depth;            // deepest level printed, -1 for all
+    int top;                  // print only the N biggest directories
+    dev_t root_dev;
+    int same_device;
+
+    char **root_args;         // as typed, for display
+    char **root_abs;          // resolved, used as cache keys
+    int cur_root;
+
+    pthread_mutex_t lock;
+    DuNode **nodes;
+    size_t count;
+    size_t cap;
+
+    // (dev, ino) of multi-link files already counted
+    LinkedFile *seen_links;
+    size_t seen_count;
+    size_t seen_slots;
+
+    DuCache cache;
+    DuTotals root_file;       // root operand that is not a directory
+    int root_file_set;
+} DuJob;
+
+static void totals_add(DuTotals *into, const DuTotals *from) {
+    into->blocks += from->blocks;
+    into->bytes += from->bytes;
+    into->files += from->files;
+}
+
+static size_t hash_path(const char *s) {
+    size_t h = 1469598103934665603ULL;
+    for (; *s; s++) {
+        h ^= (unsigned char)*s;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// ---------------------------------------------------------------------------
+// Cache file
+// ---------------------------------------------------------------------------
+
+static void cache_path(char *out, size_t size) {
+    const char *home = getenv("HOME");
+    if (!home) home = ".";
+    snprintf(out, size, "%s/.razzshell", home);
+    mkdir(out, 0777);
+    size_t len = strlen(out);
+    snprintf(out + len, size - len, "/ducache");
+}
+
+static void cache_index(DuCache *cache) {
+    cache->nslots = 16;
+    while (cache->nslots < cache->count * 2) cache->nslots *= 2;
+    cache->slots = calloc(cache->nslots, sizeof(size_t));
+    if (!cache->slots) {
+        cache->nslots = 0;
+        return;
+    }
+    for (size_t i = 0; i < cache->count; i++) {
+        size_t slot = hash_path(cache->records[i].path) & (cache->nslots - 1);
+        while (cache->slots[slot]) slot = (slot + 1) & (cache->nslots - 1);
+        cache->slots[slot] = i + 1;
+    }
+}
+
+static CacheRecord* cache_lookup(DuCache *cache, const char *path) {
+    if (cache->nslots == 0) return NULL;
+    size_t slot = hash_path(path) & (cache->nslots - 1);
+    while (cache->slots[slot]) {
+        CacheRecord *rec = &cache->records[cache->slots[slot] - 1];
+        if (strcmp(rec->path, path) == 0) return rec;
+        slot = (slot + 1) & (cache->nslots - 1);
+    }
+    return NULL;
+}
+
+static void cache_load(DuCache *cache) {
+    char path[PATH_MAX];
+    cache_path(path, sizeof(path));
+    FILE *fp = fopen(path, "r");
+    if (!fp) return;
+
+    char *line = NULL;
+    size_t line_cap = 0;
+    ssize_t len = getline(&line, &line_cap, fp);
+    if (len <= 0 || strncmp(line, CACHE_MAGIC, strlen(CACHE_MAGIC)) != 0) {
+        free(line);
+        fclose(fp);
+        return;
+    }
+
+    while ((len = getline(&line, &line_cap, fp)) > 0) {
+        if (line[len - 1] == '\n') line[--len] = '\0';
+        if (line[0] != 'D') continue;
+
+        CacheRecord rec;
+        memset(&rec, 0, sizeof(rec));
+        unsigned long long dev, ino;
+        int name_at = 0;
+        if (sscanf(line, "D %llu %llu %lld %u %lld %u %llu %llu %llu %zu %n",
+                   &dev, &ino, &rec.mtime_sec, &rec.mtime_nsec, &rec.ctime_sec, &rec.ctime_nsec,
+                   &rec.direct.blocks, &rec.direct.bytes, &rec.direct.files,
+                   &rec.nlinks, &name_at) < 10 || name_at == 0) {
+            continue;
+        }
+        rec.dev = (dev_t)dev;
+        rec.ino = (ino_t)ino;
+        rec.path = strdup(line + name_at);
+        rec.links = rec.nlinks ? calloc(rec.nlinks, sizeof(LinkedFile)) : NULL;
+        if (!rec.path || (rec.nlinks && !rec.links)) {
+            free(rec.path);
+            free(rec.links);
+            break;
+        }
+
+        int ok = 1;
+        for (size_t i = 0; i < rec.nlinks && ok; i++) {
+            unsigned long long ldev, lino;
+            ok = getline(&line, &line_cap, fp) > 0 &&
+                 sscanf(line, "L %llu %llu %llu %llu", &ldev, &lino,
+                        &rec.links[i].blocks, &rec.links[i].bytes) == 4;
+            rec.links[i].dev = (dev_t)ldev;
+            rec.links[i].ino = (ino_t)lino;
+        }
+        if (!ok) {
+            free(rec.path);
+            free(rec.links);
+            break;
+        }
+
+        if (cache->count == cache->cap) {
+            size_t cap = cache->cap ? cache->cap * 2 : 1024;
+            CacheRecord *grown = realloc(cache->records, cap * sizeof(CacheRecord));
+            if (!grown) {
+                free(rec.path);
+                free(rec.links);
+                break;
+            }
+            cache->records = grown;
+            cache->cap = cap;
+        }
+        cache->records[cache->count++] = rec;
+    }
+    free(line);
+    fclose(fp);
+    cache_index(cache);
+}
+
+static void cache_free(DuCache *cache) {
+    for (size_t i = 0; i < cache->count; i++) {
+        free(cache->records[i].path);
+        free(cache->records[i].links);
+    }
+    free(cache->records);
+    free(cache->slots);
+}
+
+static int under_root(const char *path, char **roots, int nroots) {
+    for (int i = 0; i < nroots; i++) {
+        if (!roots[i]) continue;
+        size_t len = strlen(roots[i]);
+        if (strncmp(path, roots[i], len) == 0 &&
+            (path[len] == '\0' || path[len] == '/' || (len > 0 && roots[i][len - 1] == '/'))) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void write_record(FILE *fp, const char *path, dev_t dev, ino_t ino,
+                         long long msec, unsigned mnsec, long long csec, unsigned cnsec,
+                         const DuTotals *direct, const LinkedFile *links, size_t nlinks) {
+    fprintf(fp, "D %llu %llu %lld %u %lld %u %llu %llu %llu %zu %s\n",
+            (unsigned long long)dev, (unsigned long long)ino, msec, mnsec, csec, cnsec,
+            direct->blocks, direct->bytes, direct->files, nlinks, path);
+    for (size_t i = 0; i < nlinks; i++) {
+        fprintf(fp, "L %llu %llu %llu %llu\n", (unsigned long long)links[i].dev,
+                (unsigned long long)links[i].ino, links[i].blocks, links[i].bytes);
+    }
+}
+
+// Rewrite the cache: this run's directories plus old records outside the
+// trees that were walked. Written to a temporary file and renamed into place.
+static void cache_save(DuJob *job, int nroots) {
+    char path[PATH_MAX], tmp[PATH_MAX + 8];
+    cache_path(path, sizeof(path));
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *fp = fopen(tmp, "w");
+    if (!fp) return;
+
+    fprintf(fp, "%s\n", CACHE_MAGIC);
+    for (size_t i = 0; i < job->count; i++) {
+        DuNode *n = job->nodes[i];
+        if (strchr(n->path, '\n')) continue;
+        write_record(fp, n->path, n->dev, n->ino, n->mtime_sec, n->mtime_nsec,
+                     n->ctime_sec, n->ctime_nsec, &n->direct, n->links, n->nlinks);
+    }
+    for (size_t i = 0; i < job->cache.count; i++) {
+        CacheRecord *r = &job->cache.records[i];
+        if (r->seen || under_root(r->path, job->root_abs, nroots)) continue;
+        write_record(fp, r->path, r->dev, r->ino, r->mtime_sec, r->mtime_nsec,
+                     r->ctime_sec, r->ctime_nsec, &r->direct, r->links, r->nlinks);
+    }
+
+    if (fclose(fp) == 0) {
+        rename(tmp, path);
+    } else {
+        unlink(tmp);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Walk
+// ---------------------------------------------------------------------------
+
+// Returns 1 when (dev, ino) had not been counted yet. Caller holds the job lock.
+static int link_first_seen(DuJob *job, dev_t dev, ino_t ino) {
+    if (job->seen_count * 2 >= job->seen_slots) {
+        size_t nslots = job->seen_slots ? job->seen_slots * 2 : 1024;
+        LinkedFile *grown = calloc(nslots, sizeof(LinkedFile));
+        if (!grown) return 1;
+        for (size_t i = 0; i < job->seen_slots; i++) {
+            LinkedFile *e = &job->seen_links[i];
+            if (e->ino == 0) continue;
+            size_t slot = ((size_t)e->ino * 31 + (size_t)e->dev) & (nslots - 1);
+            while (grown[slot].ino != 0) slot = (slot + 1) & (nslots - 1);
+            grown[slot] = *e;
+        }
+        free(job->seen_links);
+        job->seen_links = grown;
+        job->seen_slots = nslots;
+    }
+    size_t slot = ((size_t)ino * 31 + (size_t)dev) & (job->seen_slots - 1);
+    while (job->seen_links[slot].ino != 0) {
+        if (job->seen_links[slot].ino == ino && job->seen_links[slot].dev == dev) return 0;
+        slot = (slot + 1) & (job->seen_slots - 1);
+    }
+    job->seen_links[slot].dev = dev;
+    job->seen_links[slot].ino = ino;
+    job->seen_count++;
+    return 1;
+}
+
+static void count_linked(DuJob *job, DuNode *node, const LinkedFile *lf) {
+    pthread_mutex_lock(&job->lock);
+    int first = link_first_seen(job, lf->dev, lf->ino);
+    pthread_mutex_unlock(&job->lock);
+    if (first) {
+        node->linked.blocks += lf->blocks;
+        node->linked.bytes += lf->bytes;
+        node->linked.files++;
+    }
+}
+
+static void node_add_link(DuNode *node, const LinkedFile *lf) {
+    if (node->nlinks == node->links_cap) {
+        size_t cap = node->links_cap ? node->links_cap * 2 : 8;
+        LinkedFile *grown = realloc(node->links, cap * sizeof(LinkedFile));
+        if (!grown) return;
+        node->links = grown;
+        node->links_cap = cap;
+    }
+    node->links[node->nlinks++] = *lf;
+}
+
+static DuNode* visit_directory(DuJob *job, const FsWalkEntry *entry, const struct statx *stx) {
+    DuNode *node = calloc(1, sizeof(DuNode));
+    if (!node) return NULL;
+    node->path = strdup(entry->path);
+    if (!node->path) {
+        free(node);
+        return NULL;
+    }
+    node->parent = entry->parent_data;
+    node->root = job->cur_root;
+    node->depth = entry->depth;
+    node->dev = makedev(stx->stx_dev_major, stx->stx_dev_minor);
+    node->ino = stx->stx_ino;
+    node->mtime_sec = stx->stx_mtime.tv_sec;
+    node->mtime_nsec = stx->stx_mtime.tv_nsec;
+    node->ctime_sec = stx->stx_ctime.tv_sec;
+    node->ctime_nsec = stx->stx_ctime.tv_nsec;
+    node->own.blocks = stx->stx_blocks;
+    node->own.bytes = stx->stx_size;
+
+    // An unchanged directory has the same entries, so its file totals carry over
+    CacheRecord *rec = job->use_cache ? cache_lookup(&job->cache, node->path) : NULL;
+    if (rec && rec->dev == node->dev && rec->ino == node->ino &&
+        rec->mtime_sec == node->mtime_sec && rec->mtime_nsec == node->mtime_nsec &&
+        rec->ctime_sec == node->ctime_sec && rec->ctime_nsec == node->ctime_nsec) {
+        rec->seen = 1;
+        node->cached = rec;
+        node->direct = rec->direct;
+        for (size_t i = 0; i < rec->nlinks; i++) {
+            node_add_link(node, &rec->links[i]);
+            count_linked(job, node, &rec->links[i]);
+        }
+    }
+
+    pthread_mutex_lock(&job->lock);
+    if (job->count == job->cap) {
+        size_t cap = job->cap ? job->cap * 2 : 1024;
+        DuNode **grown = realloc(job->nodes, cap * sizeof(DuNode *));
+        if (grown) {
+            job->nodes = grown;
+            job->cap = cap;
+        }
+    }
+    if (job->count < job->cap) job->nodes[job->count++] = node;
+    pthread_mutex_unlock(&job->lock);
+    return node;
+}
+
+static int du_visit(const FsWalkEntry *entry, void *arg) {
+    DuJob *job = arg;
+    DuNode *parent = entry->parent_data;
+
+    // Files of an unchanged directory were counted from the cache
+    if (entry->type != DT_DIR && parent && parent->cached) return FS_WALK_CONTINUE;
+
+    struct statx stx;
+    unsigned int mask = STATX_BLOCKS | STATX_SIZE | STATX_INO | STATX_NLINK;
+    if (entry->type == DT_DIR) mask |= STATX_MTIME | STATX_CTIME;
+    if (fs_walk_stat(entry, mask, &stx) != 0) {
+        fprintf(stderr, "diskuse: %s: %s\n", entry->path, strerror(errno));
+        return FS_WALK_SKIP;
+    }
+    dev_t dev = makedev(stx.stx_dev_major, stx.stx_dev_minor);
+
+    if (entry->type == DT_DIR) {
+        if (job->same_device && dev != job->root_dev) return FS_WALK_SKIP;
+        DuNode *node = visit_directory(job, entry, &stx);
+        if (!node) return FS_WALK_SKIP;
+        *entry->data = node;
+        return FS_WALK_CONTINUE;
+    }
+
+    DuTotals file = { stx.stx_blocks, stx.stx_size, 1 };
+    if (!parent) {
+        job->root_file = file;
+        job->root_file_set = 1;
+        return FS_WALK_CONTINUE;
+    }
+    if (stx.stx_nlink > 1) {
+        LinkedFile lf = { dev, stx.stx_ino, stx.stx_blocks, stx.stx_size };
+        node_add_link(parent, &lf);
+        count_linked(job, parent, &lf);
+    } else {
+        totals_add(&parent->direct, &file);
+    }
+    return FS_WALK_CONTINUE;
+}
+
+static void format_human(unsigned long long bytes, char *out, size_t size) {
+    const char *units[] = {"B", "K", "M", "G", "T", "P"};
+    double value = (double)bytes;
+    int unit = 0;
+    while (value >= 1024 && unit < 5) {
+        value /= 1024;
+        unit++;
+    }
+    if (unit == 0) snprintf(out, size, "%llu%s", bytes, units[unit]);
+    else snprintf(out, size, "%.1f%s", value, units[unit]);
+}
+
+static void print_totals(DuJob *job, const DuTotals *t, const char *path) {
+    unsigned long long kb = (t->blocks + 1) / 2;
+    if (job->table) {
+        printf("%llu %llu %llu %s\n", kb, t->bytes, t->files, path);
+    } else if (job->human) {
+        char size[32];
+        format_human(t->blocks * 512ULL, size, sizeof(size));
+        printf("%s\t%s\n", size, path);
+    } else {
+        printf("%llu\t%s\n", kb, path);
+    }
+}
+
+// Paths are walked in resolved form but shown the way they were typed
+static void print_node(DuJob *job, const DuNode *node) {
+    const char *abs = job->root_abs[node->root];
+    const char *shown = job->root_args[node->root];
+    const char *rest = node->path + strlen(abs);
+    size_t slen = strlen(shown);
+    if (slen > 0 && shown[slen - 1] == '/' && rest[0] == '/') rest++;
+
+    char display[PATH_MAX * 2];
+    snprintf(display, sizeof(display), "%s%s", shown, rest);
+    print_totals(job, &node->total, display);
+}
+
+static int should_print(const DuJob *job, const DuNode *node) {
+    if (job->summarize) return node->depth == 0;
+    return job->max_depth < 0 || node->depth <= job->max_depth;
+}
+
+static void du_leave(void *data, void *arg) {
+    DuJob *job = arg;
+    DuNode *node = data;
+
+    node->total = node->own;
+    node->total.files = 0;
+    totals_add(&node->total, &node->direct);
+    totals_add(&node->total, &node->linked);
+
+    pthread_mutex_lock(&job->lock);
+    totals_add(&node->total, &node->children);
+    if (node->parent) totals_add(&node->parent->children, &node->total);
+    // Children always finish before their parent, so output stays post-order like du
+    if (!job->top && should_print(job, node)) print_node(job, node);
+    pthread_mutex_unlock(&job->lock);
+}
+
+static int compare_size_desc(const void *a, const void *b) {
+    const DuNode *x = *(DuNode * const *)a;
+    const DuNode *y = *(DuNode * const *)b;
+    if (x->total.blocks != y->total.blocks) return x->total.blocks < y->total.blocks ? 1 : -1;
+    return strcmp(x->path, y->path);
+}
+
+static int run_external_du(char **args) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        execvp("du", args);
+        perror("diskuse");
+        exit(EXIT_FAILURE);
+    } else if (pid > 0) {
+        waitpid(pid, NULL, 0);
+    } else {
+        perror("fork");
+    }
+    return 1;
+}
+
+int razz_diskuse(char **args) {
+    DuJob job;
+    memset(&job, 0, sizeof(job));
+    job.use_cache = 1;
+    job.save_cache = 1;
+    job.max_depth = -1;
+
+    int argi = 1;
+    for (; args[argi] != NULL && args[argi][0] == '-' && args[argi][1] != '\0'; argi++) {
+        const char *a = args[argi];
+        if (strcmp(a, "--") == 0) {
+            argi++;
+            break;
+        }
+        if (strcmp(a, "--top") == 0 && args[argi + 1]) {
+            job.top = atoi(args[++argi]);
+            if (job.top <= 0) return run_external_du(args);
+        } else if (strcmp(a, "--table") == 0) {
+            job.table = 1;
+        } else if (strcmp(a, "--no-cache") == 0) {
+            job.use_cache = 0;
+            job.save_cache = 0;
+        } else if (strcmp(a, "--refresh") == 0) {
+            job.use_cache = 0;
+        } else if ((strcmp(a, "-d") == 0 || strcmp(a, "--max-depth") == 0) && args[argi + 1]) {
+            job.max_depth = atoi(args[++argi]);
+        } else if (strncmp(a, "--max-depth=", 12) == 0) {
+            job.max_depth = atoi(a + 12);
+        } else if (a[1] != '-' && strspn(a + 1, "shcx") == strlen(a + 1)) {
+            job.summarize |= strchr(a, 's') != NULL;
+            job.human |= strchr(a, 'h') != NULL;
+            job.grand_total |= strchr(a, 'c') != NULL;
+            job.same_device |= strchr(a, 'x') != NULL;
+        } else {
+            return run_external_du(args);
+        }
+    }
+
+    char *default_root[] = { ".", NULL };
+    char **roots = args[argi] ? &args[argi] : default_root;
+    int nroots = 0;
+    while (roots[nroots]) nroots++;
+
+    job.root_args = roots;
+    job.root_abs = calloc((size_t)nroots, sizeof(char *));
+    if (!job.root_abs) return 1;
+    pthread_mutex_init(&job.lock, NULL);
+    if (job.use_cache) cache_load(&job.cache);
+
+    FsWalkOptions opt;
+    fs_walk_options_init(&opt, "diskuse");
+    opt.leave_dir = du_leave;
+    opt.same_device = job.same_device;
+
+    if (job.table) printf("KB BYTES FILES PATH\n");
+
+    DuTotals grand = {0, 0, 0};
+    for (int r = 0; r < nroots; r++) {
+        job.root_abs[r] = realpath(roots[r], NULL);
+        if (!job.root_abs[r]) {
+            fprintf(stderr, "diskuse: %s: %s\n", roots[r], strerror(errno));
+            continue;
+        }
+        struct stat st;
+        if (lstat(job.root_abs[r], &st) != 0) continue;
+        job.root_dev = st.st_dev;
+        job.cur_root = r;
+        job.root_file_set = 0;
+        size_t first_node = job.count;
+
+        fs_walk(job.root_abs[r], &opt, du_visit, &job);
+
+        if (job.root_file_set) {
+            totals_add(&grand, &job.root_file);
+            if (!job.top) print_totals(&job, &job.root_file, roots[r]);
+        } else if (job.count > first_node) {
+            totals_add(&grand, &job.nodes[first_node]->total);
+        }
+    }
+
+    if (job.top) {
+        qsort(job.nodes, job.count, sizeof(DuNode *), compare_size_desc);
+        for (size_t i = 0; i < job.count && i < (size_t)job.top; i++) {
+            print_node(&job, job.nodes[i]);
+        }
+    }
+    if (job.grand_total) print_totals(&job, &grand, "total");
+    fflush(stdout);
+
+    if (job.save_cache) cache_save(&job, nroots);
+
+    for (size_t i = 0; i < job.count; i++) {
+        free(job.nodes[i]->path);
+        free(job.nodes[i]->links);
+        free(job.nodes[i]);
+    }
+    free(job.nodes);
+    free(job.seen_links);
+    cache_free(&job.cache);
+    for (int r = 0; r < nroots; r++) free(job.root_abs[r]);
+    free(job.root_abs);
+    pthread_mutex_destroy(&job.lock);
+    return 1;
+}
@@ -0,0 +1,15 @@
+#ifndef DISK_USAGE_H
+#define DISK_USAGE_H
+
+// Command: diskuse (du)
+// diskuse [-s] [-h] [-c] [-x] [-d N] [--top N] [--table] [--refresh | --no-cache] [path...]
+// Walks each path in parallel, counting hard-linked files once per
+// (dev, ino). Per-directory subtotals are cached in ~/.razzshell/ducache
+// keyed on the directory's inode, mtime and ctime; directories that have not
+// changed since the last run are listed but their files are not re-stat'ed.
+// A file rewritten in place does not touch its directory, so --refresh
+// recounts everything and rewrites the cache. --table prints
+// KB BYTES FILES PATH rows for the object pipeline.
+int razz_diskuse(char **args);
+
+#endif // DISK_USAGE_H
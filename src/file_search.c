@@ -0,0 +1,275 @@
+#define _GNU_SOURCE
+#include "file_search.h"
+#include "fs_walk.h"
+#include "out_sink.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <dirent.h>
+#include <fnmatch.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define SECONDS_PER_DAY 86400
+
+// How a numeric test compares: -N, N or +N
+typedef enum {
+    CMP_NONE,
+    CMP_LESS,
+    CMP_EQUAL,
+    CMP_GREATER
+} NumCompare;
+
+typedef struct {
+    const char *name_glob;
+    int name_flags;
+    int type;                   // DT_* or -1
+    NumCompare size_cmp;
+    unsigned long long size_val;
+    unsigned long long size_unit;
+    NumCompare mtime_cmp;
+    long long mtime_days;
+    int min_depth;
+    int sorted;
+    time_t now;
+
+    // Output state shared by the walker threads
+    pthread_mutex_t lock;
+    OutSink out;
+    char **matches;
+    size_t count;
+    size_t cap;
+} SearchQuery;
+
+// Parse [+-]N, with a find-style unit suffix when with_units is set
+static int parse_numeric(const char *arg, NumCompare *cmp, unsigned long long *value,
+                         unsigned long long *unit, int with_units) {
+    *cmp = CMP_EQUAL;
+    if (*arg == '+') {
+        *cmp = CMP_GREATER;
+        arg++;
+    } else if (*arg == '-') {
+        *cmp = CMP_LESS;
+        arg++;
+    }
+    if (*arg < '0' || *arg > '9') return -1;
+
+    char *end;
+    errno = 0;
+    *value = strtoull(arg, &end, 10);
+    if (errno != 0) return -1;
+
+    if (!with_units) return *end == '\0' ? 0 : -1;
+
+    *unit = 512;
+    if (*end != '\0') {
+        switch (*end) {
+            case 'c': *unit = 1; break;
+            case 'w': *unit = 2; break;
+            case 'b': *unit = 512; break;
+            case 'k': *unit = 1024ULL; break;
+            case 'M': *unit = 1024ULL * 1024; break;
+            case 'G': *unit = 1024ULL * 1024 * 1024; break;
+            default: return -1;
+        }
+        if (end[1] != '\0') return -1;
+    }
+    return 0;
+}
+
+static int compare_numeric(NumCompare cmp, unsigned long long actual, unsigned long long want) {
+    switch (cmp) {
+        case CMP_LESS: return actual < want;
+        case CMP_GREATER: return actual > want;
+        case CMP_EQUAL: return actual == want;
+        default: return 1;
+    }
+}
+
+static int parse_type(const char *arg) {
+    if (arg[0] == '\0' || arg[1] != '\0') return -1;
+    switch (arg[0]) {
+        case 'f': return DT_REG;
+        case 'd': return DT_DIR;
+        case 'l': return DT_LNK;
+        case 'b': return DT_BLK;
+        case 'c': return DT_CHR;
+        case 'p': return DT_FIFO;
+        case 's': return DT_SOCK;
+        default: return -1;
+    }
+}
+
+// Fill the query and walk options from args; the paths are args[1..*first_test).
+// Returns -1 for anything that needs the full find expression language.
+static int parse_query(char **args, SearchQuery *q, FsWalkOptions *opt, int *first_test) {
+    int i = 1;
+    while (args[i] != NULL && args[i][0] != '-' && strcmp(args[i], "!") != 0 &&
+           strcmp(args[i], "(") != 0) {
+        i++;
+    }
+    *first_test = i;
+
+    for (; args[i] != NULL; i++) {
+        const char *test = args[i];
+        const char *val = args[i + 1];
+
+        if (strcmp(test, "--sort") == 0) {
+            q->sorted = 1;
+            continue;
+        }
+        if (strcmp(test, "-xdev") == 0 || strcmp(test, "-mount") == 0) {
+            opt->same_device = 1;
+            continue;
+        }
+        if (strcmp(test, "-print") == 0) continue;
+        if (val == NULL) return -1;
+
+        if (strcmp(test, "-name") == 0 || strcmp(test, "-iname") == 0) {
+            q->name_glob = val;
+            q->name_flags = test[1] == 'i' ? FNM_CASEFOLD : 0;
+        } else if (strcmp(test, "-type") == 0) {
+            if ((q->type = parse_type(val)) < 0) return -1;
+        } else if (strcmp(test, "-size") == 0) {
+            if (parse_numeric(val, &q->size_cmp, &q->size_val, &q->size_unit, 1) != 0) return -1;
+        } else if (strcmp(test, "-mtime") == 0) {
+            unsigned long long days;
+            if (parse_numeric(val, &q->mtime_cmp, &days, NULL, 0) != 0) return -1;
+            q->mtime_days = (long long)days;
+        } else if (strcmp(test, "-mindepth") == 0 || strcmp(test, "-maxdepth") == 0) {
+            char *end;
+            long depth = strtol(val, &end, 10);
+            if (*end != '\0' || depth < 0) return -1;
+            if (test[2] == 'i') q->min_depth = (int)depth;
+            else opt->max_depth = (int)depth;
+        } else {
+            return -1;
+        }
+        i++;
+    }
+    return 0;
+}
+
+static void emit_match(SearchQuery *q, const char *path) {
+    pthread_mutex_lock(&q->lock);
+    if (q->sorted) {
+        if (q->count == q->cap) {
+            size_t cap = q->cap ? q->cap * 2 : 256;
+            char **grown = realloc(q->matches, cap * sizeof(char *));
+            if (grown) {
+                q->matches = grown;
+                q->cap = cap;
+            }
+        }
+        if (q->count < q->cap) {
+            q->matches[q->count] = strdup(path);
+            if (q->matches[q->count]) q->count++;
+        }
+    } else {
+        out_sink_puts(&q->out, path);
+        out_sink_write(&q->out, "\n", 1);
+    }
+    pthread_mutex_unlock(&q->lock);
+}
+
+static int visit_entry(const FsWalkEntry *entry, void *arg) {
+    SearchQuery *q = arg;
+
+    // Cheap tests first: depth, d_type and the name never need a stat
+    if (entry->depth < q->min_depth) return FS_WALK_CONTINUE;
+    if (q->type >= 0 && entry->type != q->type) return FS_WALK_CONTINUE;
+    if (q->name_glob && fnmatch(q->name_glob, entry->name, q->name_flags) != 0) {
+        return FS_WALK_CONTINUE;
+    }
+
+    unsigned int mask = 0;
+    if (q->size_cmp != CMP_NONE) mask |= STATX_SIZE;
+    if (q->mtime_cmp != CMP_NONE) mask |= STATX_MTIME;
+    if (mask) {
+        struct statx stx;
+        if (fs_walk_stat(entry, mask, &stx) != 0) return FS_WALK_CONTINUE;
+        if (q->size_cmp != CMP_NONE) {
+            unsigned long long units = (stx.stx_size + q->size_unit - 1) / q->size_unit;
+            if (!compare_numeric(q->size_cmp, units, q->size_val)) return FS_WALK_CONTINUE;
+        }
+        if (q->mtime_cmp != CMP_NONE) {
+            long long age = ((long long)q->now - stx.stx_mtime.tv_sec) / SECONDS_PER_DAY;
+            if (age < 0) age = 0;
+            if (!compare_numeric(q->mtime_cmp, (unsigned long long)age,
+                                 (unsigned long long)q->mtime_days)) {
+                return FS_WALK_CONTINUE;
+            }
+        }
+    }
+
+    emit_match(q, entry->path);
+    // A closed pipe downstream means nobody wants the rest
+    return q->out.failed ? FS_WALK_STOP : FS_WALK_CONTINUE;
+}
+
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+static int run_external_find(char **args) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        execvp("find", args);
+        perror("searchfile");
+        exit(EXIT_FAILURE);
+    } else if (pid > 0) {
+        waitpid(pid, NULL, 0);
+    } else {
+        perror("fork");
+    }
+    return 1;
+}
+
+int razz_searchfile(char **args) {
+    if (args[1] == NULL) {
+        fprintf(stderr, "Usage: searchfile [path...] [-name GLOB] [-type X] [-size N] [-mtime N] [--sort]\n");
+        return 1;
+    }
+
+    SearchQuery q;
+    memset(&q, 0, sizeof(q));
+    q.type = -1;
+    q.now = time(NULL);
+
+    FsWalkOptions opt;
+    fs_walk_options_init(&opt, "searchfile");
+
+    int first_test;
+    if (parse_query(args, &q, &opt, &first_test) != 0) {
+        return run_external_find(args);
+    }
+    pthread_mutex_init(&q.lock, NULL);
+    out_sink_open(&q.out, STDOUT_FILENO);
+
+    char *default_root[] = { ".", NULL };
+    char **roots = first_test > 1 ? &args[1] : default_root;
+    int nroots = first_test > 1 ? first_test - 1 : 1;
+
+    for (int r = 0; r < nroots && !q.out.failed; r++) {
+        fs_walk(roots[r], &opt, visit_entry, &q);
+        if (q.sorted) {
+            qsort(q.matches, q.count, sizeof(char *), compare_paths);
+            for (size_t i = 0; i < q.count; i++) {
+                out_sink_puts(&q.out, q.matches[i]);
+                out_sink_write(&q.out, "\n", 1);
+                free(q.matches[i]);
+            }
+            q.count = 0;
+        }
+    }
+    out_sink_close(&q.out);
+
+    free(q.matches);
+    pthread_mutex_destroy(&q.lock);
+    return 1;
+}
@@ -0,0 +1,13 @@
+#ifndef FILE_SEARCH_H
+#define FILE_SEARCH_H
+
+// Command: searchfile (find)
+// searchfile [PATH...] [-name GLOB] [-iname GLOB] [-type f|d|l|b|c|p|s]
+//            [-size [+-]N[cwbkMG]] [-mtime [+-]N] [-mindepth N] [-maxdepth N]
+//            [-xdev] [--sort]
+// Runs on the parallel walker in fs_walk.h. Matches stream out unordered as
+// they are found; --sort collects and sorts them per PATH. Expressions the
+// walker cannot evaluate (-o, !, -exec, ...) are handed to the system find.
+int razz_searchfile(char **args);
+
+#endif // FILE_SEARCH_H
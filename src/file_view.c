@@ -0,0 +1,722 @@
+#define _GNU_SOURCE
+#include "file_view.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/sendfile.h>
+#include <sys/inotify.h>
+#include <poll.h>
+#include <signal.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define VIEW_BUF_SIZE   (1024 * 1024)
+#define SPLICE_CHUNK    (1024 * 1024)
+#define HEAD_CHUNK      (64 * 1024)
+#define TAIL_BLOCK_MIN  (64 * 1024)
+#define TAIL_STREAM_MIN (1024 * 1024)
+#define DEFAULT_LINES   10
+
+// How stdout is connected decides which copy primitive is usable
+typedef enum {
+    OUT_OTHER,     // terminal, char device, ...: plain read/write
+    OUT_PIPE,      // splice()
+    OUT_FILE,      // copy_file_range()
+    OUT_SOCKET     // sendfile()
+} OutputKind;
+
+// One buffer shared by every file of every readfile invocation
+static char *view_buf = NULL;
+
+static OutputKind output_kind(void) {
+    struct stat st;
+    if (fstat(STDOUT_FILENO, &st) != 0) return OUT_OTHER;
+    if (S_ISFIFO(st.st_mode)) return OUT_PIPE;
+    if (S_ISREG(st.st_mode)) return OUT_FILE;
+    if (S_ISSOCK(st.st_mode)) return OUT_SOCKET;
+    return OUT_OTHER;
+}
+
+static int write_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static char *view_buffer(void) {
+    if (!view_buf) view_buf = malloc(VIEW_BUF_SIZE);
+    return view_buf;
+}
+
+static int copy_buffered(int fd) {
+    if (!view_buffer()) return -1;
+    ssize_t n;
+    while ((n = read(fd, view_buf, VIEW_BUF_SIZE)) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (write_all(STDOUT_FILENO, view_buf, (size_t)n) != 0) return -1;
+    }
+    return 0;
+}
+
+// Try the zero-copy primitive for this output kind. Returns 1 when the whole
+// input was transferred, 0 when the caller should fall back to read/write
+// (possibly after some bytes were already sent), -1 on a hard error.
+static int copy_zero(int fd, OutputKind kind, const struct stat *in_st) {
+    for (;;) {
+        ssize_t n;
+        switch (kind) {
+            case OUT_PIPE:
+                n = splice(fd, NULL, STDOUT_FILENO, NULL, SPLICE_CHUNK, SPLICE_F_MOVE | SPLICE_F_MORE);
+                break;
+            case OUT_FILE:
+                if (!S_ISREG(in_st->st_mode)) return 0;
+                n = copy_file_range(fd, NULL, STDOUT_FILENO, NULL, SPLICE_CHUNK, 0);
+                break;
+            case OUT_SOCKET:
+                if (!S_ISREG(in_st->st_mode)) return 0;
+                n = sendfile(STDOUT_FILENO, fd, NULL, SPLICE_CHUNK);
+                break;
+            default:
+                return 0;
+        }
+        if (n > 0) continue;
+        if (n == 0) return 1;
+        if (errno == EINTR) continue;
+        if (errno == EINVAL || errno == ENOSYS || errno == EXDEV || errno == EOPNOTSUPP) return 0;
+        return -1;
+    }
+}
+
+int file_view_stream_fd(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) return -1;
+
+    // Anything printed through stdio so far must land before the raw bytes
+    fflush(stdout);
+
+    OutputKind kind = output_kind();
+    if (S_ISREG(st.st_mode)) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+    int rc = copy_zero(fd, kind, &st);
+    if (rc == 1) return 0;
+    if (rc < 0) return -1;
+    return copy_buffered(fd);
+}
+
+// Options other than a lone "-" are handed to the system cat
+static int needs_external_cat(char **args) {
+    for (int i = 1; args[i] != NULL; i++) {
+        if (args[i][0] == '-' && args[i][1] != '\0') return 1;
+    }
+    return 0;
+}
+
+// Run the coreutils equivalent for option combinations we do not implement
+static int run_external_tool(const char *tool, char **args) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        execvp(tool, args);
+        perror(args[0]);
+        exit(EXIT_FAILURE);
+    } else if (pid > 0) {
+        waitpid(pid, NULL, 0);
+    } else {
+        perror("fork");
+    }
+    return 1;
+}
+
+int razz_readfile(char **args) {
+    if (args[1] == NULL) {
+        if (isatty(STDIN_FILENO)) {
+            fprintf(stderr, "Usage: readfile [filename...]\n");
+            return 1;
+        }
+        // Pipeline stage with no operands: behave like cat and pass stdin through
+        if (file_view_stream_fd(STDIN_FILENO) != 0 && errno != EPIPE) {
+            perror("readfile");
+        }
+        return 1;
+    }
+
+    if (needs_external_cat(args)) {
+        return run_external_tool("cat", args);
+    }
+
+    for (int i = 1; args[i] != NULL; i++) {
+        int fd;
+        if (strcmp(args[i], "-") == 0) {
+            fd = STDIN_FILENO;
+        } else {
+            fd = open(args[i], O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                fprintf(stderr, "readfile: %s: %s\n", args[i], strerror(errno));
+                continue;
+            }
+        }
+
+        int rc = file_view_stream_fd(fd);
+        int saved = errno;
+        if (fd != STDIN_FILENO) close(fd);
+        if (rc != 0) {
+            if (saved == EPIPE) break; // reader went away, stop quietly
+            fprintf(stderr, "readfile: %s: %s\n", args[i], strerror(saved));
+        }
+    }
+    return 1;
+}
+
+// ---------------------------------------------------------------------------
+// headfile / tailfile
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    size_t count;     // lines, or bytes with -c
+    int bytes;
+    int follow;       // tailfile -f/-F: follow by name
+    int first_file;   // index of the first operand in args
+} ViewOptions;
+
+// Accepts -n N, -nN, -N, -c N and (for tailfile) -f/-F. Returns -1 for
+// anything else (+N, size suffixes, -q, ...) so the caller can defer to
+// the system tool.
+static int parse_view_options(char **args, int allow_follow, ViewOptions *opt) {
+    opt->count = DEFAULT_LINES;
+    opt->bytes = 0;
+    opt->follow = 0;
+
+    int i = 1;
+    for (; args[i] != NULL && args[i][0] == '-' && args[i][1] != '\0'; i++) {
+        const char *a = args[i];
+        const char *value;
+        if (strcmp(a, "--") == 0) {
+            i++;
+            break;
+        }
+        if (a[1] >= '0' && a[1] <= '9') {
+            value = a + 1;
+            opt->bytes = 0;
+        } else if (a[1] == 'n' || a[1] == 'c') {
+            opt->bytes = (a[1] == 'c');
+            value = a[2] ? a + 2 : args[++i];
+            if (value == NULL) return -1;
+        } else if (allow_follow && (strcmp(a, "-f") == 0 || strcmp(a, "-F") == 0)) {
+            opt->follow = 1;
+            continue;
+        } else {
+            return -1;
+        }
+
+        if (*value == '\0') return -1;
+        size_t n = 0;
+        for (const char *c = value; *c; c++) {
+            if (*c < '0' || *c > '9') return -1;
+            n = n * 10 + (size_t)(*c - '0');
+        }
+        opt->count = n;
+    }
+    opt->first_file = i;
+    return 0;
+}
+
+// Find the want-th newline scanning forward. Returns its index, or -1 after
+// subtracting the newlines that were seen from *want. *want must be > 0.
+static ssize_t nth_newline_forward(const char *buf, size_t len, size_t *want) {
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i nl = _mm_set1_epi8('\n');
+    for (; i + 16 <= len; i += 16) {
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(buf + i)), nl));
+        size_t found = (size_t)__builtin_popcount(mask);
+        if (found < *want) {
+            *want -= found;
+            continue;
+        }
+        while (--*want > 0) mask &= mask - 1;
+        return (ssize_t)(i + (size_t)__builtin_ctz(mask));
+    }
+#endif
+    for (; i < len; i++) {
+        if (buf[i] == '\n' && --*want == 0) return (ssize_t)i;
+    }
+    return -1;
+}
+
+// Same as above but scanning from the end of buf towards the start
+static ssize_t nth_newline_backward(const char *buf, size_t len, size_t *want) {
+    size_t i = len;
+#ifdef __SSE2__
+    const __m128i nl = _mm_set1_epi8('\n');
+    while (i >= 16) {
+        i -= 16;
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(buf + i)), nl));
+        size_t found = (size_t)__builtin_popcount(mask);
+        if (found < *want) {
+            *want -= found;
+            continue;
+        }
+        for (;;) {
+            int bit = 31 - __builtin_clz(mask);
+            if (--*want == 0) return (ssize_t)(i + (size_t)bit);
+            mask &= ~(1u << bit);
+        }
+    }
+#endif
+    while (i > 0) {
+        i--;
+        if (buf[i] == '\n' && --*want == 0) return (ssize_t)i;
+    }
+    return -1;
+}
+
+static void print_file_header(const char *name, int *printed) {
+    printf("%s==> %s <==\n", *printed ? "\n" : "", name);
+    *printed = 1;
+}
+
+// Emit the first lines/bytes of fd and stop reading as soon as they are out
+static int head_fd(int fd, const ViewOptions *opt) {
+    char *buf = view_buffer();
+    if (!buf) return -1;
+    fflush(stdout);
+
+    size_t remaining = opt->count;
+    while (remaining > 0) {
+        size_t chunk = HEAD_CHUNK;
+        if (opt->bytes && remaining < chunk) chunk = remaining;
+        ssize_t n = read(fd, buf, chunk);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) break;
+
+        size_t emit = (size_t)n;
+        if (opt->bytes) {
+            remaining -= emit;
+        } else {
+            ssize_t hit = nth_newline_forward(buf, emit, &remaining);
+            if (hit >= 0) {
+                emit = (size_t)hit + 1;
+                remaining = 0;
+            }
+        }
+        if (write_all(STDOUT_FILENO, buf, emit) != 0) return -1;
+
+        // Hand unread input back so a seekable stdin is left just past our lines
+        if (emit < (size_t)n) lseek(fd, (off_t)emit - (off_t)n, SEEK_CUR);
+    }
+    return 0;
+}
+
+// Offset in buf where the last count lines/bytes begin
+static size_t tail_start(const char *buf, size_t len, const ViewOptions *opt) {
+    if (opt->bytes) return len > opt->count ? len - opt->count : 0;
+    if (opt->count == 0) return len;
+    // A final newline ends the last line rather than starting a new one
+    size_t scan = (len > 0 && buf[len - 1] == '\n') ? len - 1 : len;
+    size_t want = opt->count;
+    ssize_t hit = nth_newline_backward(buf, scan, &want);
+    return hit >= 0 ? (size_t)hit + 1 : 0;
+}
+
+// Regular files: read backwards from EOF in growing blocks until enough
+// newlines are found, then stream the tail with the zero-copy path
+static int tail_seekable(int fd, off_t size, const ViewOptions *opt) {
+    off_t start = 0;
+    if (opt->bytes) {
+        start = size > (off_t)opt->count ? size - (off_t)opt->count : 0;
+    } else if (opt->count == 0) {
+        start = size;
+    } else if (size > 0) {
+        char *buf = view_buffer();
+        if (!buf) return -1;
+        size_t want = opt->count;
+        size_t block = TAIL_BLOCK_MIN;
+        off_t pos = size;
+        int at_end = 1;
+        while (pos > 0) {
+            size_t n = pos > (off_t)block ? block : (size_t)pos;
+            pos -= (off_t)n;
+            size_t got = 0;
+            while (got < n) {
+                ssize_t r = pread(fd, buf + got, n - got, pos + (off_t)got);
+                if (r < 0 && errno == EINTR) continue;
+                if (r <= 0) return -1;
+                got += (size_t)r;
+            }
+            size_t scan = n;
+            if (at_end && buf[n - 1] == '\n') scan--;
+            at_end = 0;
+            ssize_t hit = nth_newline_backward(buf, scan, &want);
+            if (hit >= 0) {
+                start = pos + hit + 1;
+                break;
+            }
+            if (block < VIEW_BUF_SIZE) block *= 2;
+        }
+    }
+    if (lseek(fd, start, SEEK_SET) < 0) return -1;
+    return file_view_stream_fd(fd);
+}
+
+// Pipes and other unseekable input: keep a buffer that is trimmed back to
+// the current tail whenever it would have to grow
+static int tail_stream(int fd, const ViewOptions *opt) {
+    size_t cap = TAIL_STREAM_MIN;
+    size_t used = 0;
+    char *buf = malloc(cap);
+    if (!buf) return -1;
+
+    for (;;) {
+        if (cap - used < HEAD_CHUNK) {
+            size_t drop = tail_start(buf, used, opt);
+            if (drop > 0) {
+                memmove(buf, buf + drop, used - drop);
+                used -= drop;
+            }
+            if (cap - used < HEAD_CHUNK) {
+                char *grown = realloc(buf, cap * 2);
+                if (!grown) {
+                    free(buf);
+                    return -1;
+                }
+                buf = grown;
+                cap *= 2;
+            }
+        }
+        ssize_t n = read(fd, buf + used, cap - used);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            free(buf);
+            return -1;
+        }
+        if (n == 0) break;
+        used += (size_t)n;
+    }
+
+    size_t start = tail_start(buf, used, opt);
+    fflush(stdout);
+    int rc = write_all(STDOUT_FILENO, buf + start, used - start);
+    free(buf);
+    return rc;
+}
+
+static int tail_fd(int fd, const ViewOptions *opt) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) return -1;
+    if (S_ISREG(st.st_mode)) return tail_seekable(fd, st.st_size, opt);
+    return tail_stream(fd, opt);
+}
+
+// One file followed by name across truncation and rotation
+typedef struct {
+    const char *name;
+    const char *base;   // name within its directory, matched against dir events
+    int fd;             // -1 while nothing exists under the name
+    dev_t dev;
+    ino_t ino;
+    off_t offset;
+    int wd;             // watch on the open file
+    int dir_wd;         // watch on the parent directory
+} FollowTarget;
+
+static volatile sig_atomic_t follow_interrupted = 0;
+
+static void follow_sigint(int signo) {
+    (void)signo;
+    follow_interrupted = 1;
+}
+
+static int follow_attach(int in, FollowTarget *t) {
+    struct stat st;
+    int fd = open(t->name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return -1;
+    }
+    t->fd = fd;
+    t->dev = st.st_dev;
+    t->ino = st.st_ino;
+    t->offset = 0;
+    t->wd = inotify_add_watch(in, t->name, IN_MODIFY | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF);
+    return 0;
+}
+
+static void follow_detach(int in, FollowTarget *t) {
+    if (t->wd >= 0) inotify_rm_watch(in, t->wd);
+    if (t->fd >= 0) close(t->fd);
+    t->wd = -1;
+    t->fd = -1;
+}
+
+// Print whatever was appended since the last look
+static int follow_drain(FollowTarget *targets, int idx, int ntargets, int *last) {
+    FollowTarget *t = &targets[idx];
+    struct stat st;
+    if (t->fd < 0 || fstat(t->fd, &st) != 0) return 0;
+    if (st.st_size < t->offset) {
+        fprintf(stderr, "tailfile: %s: file truncated\n", t->name);
+        t->offset = 0;
+    }
+    if (st.st_size == t->offset) return 0;
+
+    if (ntargets > 1 && *last != idx) {
+        int printed = 1;
+        print_file_header(t->name, &printed);
+        *last = idx;
+    }
+    if (lseek(t->fd, t->offset, SEEK_SET) < 0) return 0;
+    int rc = file_view_stream_fd(t->fd);
+    off_t pos = lseek(t->fd, 0, SEEK_CUR);
+    if (pos >= 0) t->offset = pos;
+    return rc;
+}
+
+// Re-resolve the name: same inode means new data, a different inode means
+// the file was rotated and the new one is followed from its start
+static int follow_check(int in, FollowTarget *targets, int idx, int ntargets, int *last) {
+    FollowTarget *t = &targets[idx];
+    struct stat st;
+    if (stat(t->name, &st) != 0) {
+        if (t->fd >= 0) {
+            int rc = follow_drain(targets, idx, ntargets, last);
+            follow_detach(in, t);
+            fprintf(stderr, "tailfile: '%s' has become inaccessible\n", t->name);
+            return rc;
+        }
+        return 0;
+    }
+    if (t->fd >= 0 && st.st_dev == t->dev && st.st_ino == t->ino) {
+        return follow_drain(targets, idx, ntargets, last);
+    }
+
+    int was_open = t->fd >= 0;
+    if (was_open) {
+        if (follow_drain(targets, idx, ntargets, last) != 0) return -1;
+        follow_detach(in, t);
+    }
+    if (follow_attach(in, t) != 0) return 0;
+    fprintf(stderr, "tailfile: '%s' has %s; following new file\n", t->name,
+            was_open ? "been replaced" : "appeared");
+    return follow_drain(targets, idx, ntargets, last);
+}
+
+static void follow_files(FollowTarget *targets, int ntargets, int last) {
+    int in = inotify_init1(IN_CLOEXEC);
+    if (in < 0) {
+        perror("tailfile: inotify");
+        return;
+    }
+
+    for (int i = 0; i < ntargets; i++) {
+        FollowTarget *t = &targets[i];
+        t->wd = -1;
+        if (t->fd >= 0) {
+            t->wd = inotify_add_watch(in, t->name, IN_MODIFY | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF);
+        }
+        // The directory watch notices the name coming back after rotation
+        char dir[4096];
+        const char *slash = strrchr(t->name, '/');
+        if (slash == NULL) {
+            strcpy(dir, ".");
+            t->base = t->name;
+        } else {
+            size_t dlen = slash == t->name ? 1 : (size_t)(slash - t->name);
+            if (dlen >= sizeof(dir)) dlen = sizeof(dir) - 1;
+            memcpy(dir, t->name, dlen);
+            dir[dlen] = '\0';
+            t->base = slash + 1;
+        }
+        t->dir_wd = inotify_add_watch(in, dir, IN_CREATE | IN_MOVED_TO);
+    }
+
+    struct sigaction sa, old_sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = follow_sigint;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, &old_sa);
+    follow_interrupted = 0;
+
+    // When feeding a pipe, a departed reader shows up as POLLERR on stdout
+    int watch_stdout = output_kind() == OUT_PIPE;
+    char *pending = calloc((size_t)ntargets, 1);
+    char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    fflush(stdout);
+
+    while (pending && !follow_interrupted) {
+        struct pollfd pfd[2] = {
+            { .fd = in, .events = POLLIN },
+            { .fd = STDOUT_FILENO, .events = 0 }
+        };
+        if (poll(pfd, watch_stdout ? 2 : 1, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (watch_stdout && (pfd[1].revents & (POLLERR | POLLHUP))) break;
+        if (!(pfd[0].revents & POLLIN)) continue;
+
+        ssize_t len = read(in, events, sizeof(events));
+        if (len < 0 && errno == EINTR) continue;
+        if (len <= 0) break;
+
+        // Coalesce the batch so each file is looked at once
+        memset(pending, 0, (size_t)ntargets);
+        for (char *p = events; p < events + len; ) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            p += sizeof(struct inotify_event) + ev->len;
+            for (int i = 0; i < ntargets; i++) {
+                if ((ev->mask & IN_Q_OVERFLOW) || ev->wd == targets[i].wd ||
+                    (ev->wd == targets[i].dir_wd && ev->len > 0 &&
+                     strcmp(ev->name, targets[i].base) == 0)) {
+                    pending[i] = 1;
+                }
+            }
+        }
+        int stop = 0;
+        for (int i = 0; i < ntargets && !stop; i++) {
+            if (pending[i] && follow_check(in, targets, i, ntargets, &last) != 0 && errno == EPIPE) {
+                stop = 1;
+            }
+        }
+        if (stop) break;
+    }
+
+    sigaction(SIGINT, &old_sa, NULL);
+    free(pending);
+    close(in);
+}
+
+int razz_headfile(char **args) {
+    ViewOptions opt;
+    if (parse_view_options(args, 0, &opt) != 0) {
+        return run_external_tool("head", args);
+    }
+
+    char **files = &args[opt.first_file];
+    if (files[0] == NULL) {
+        if (isatty(STDIN_FILENO)) {
+            fprintf(stderr, "Usage: headfile [-n lines | -c bytes] [filename...]\n");
+            return 1;
+        }
+        if (head_fd(STDIN_FILENO, &opt) != 0 && errno != EPIPE) {
+            perror("headfile");
+        }
+        return 1;
+    }
+
+    int multi = files[1] != NULL;
+    int printed = 0;
+    for (int i = 0; files[i] != NULL; i++) {
+        int is_stdin = strcmp(files[i], "-") == 0;
+        int fd = is_stdin ? STDIN_FILENO : open(files[i], O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            fprintf(stderr, "headfile: %s: %s\n", files[i], strerror(errno));
+            continue;
+        }
+        if (multi) print_file_header(is_stdin ? "standard input" : files[i], &printed);
+        int rc = head_fd(fd, &opt);
+        int saved = errno;
+        if (!is_stdin) close(fd);
+        if (rc != 0) {
+            if (saved == EPIPE) break;
+            fprintf(stderr, "headfile: %s: %s\n", files[i], strerror(saved));
+        }
+    }
+    fflush(stdout);
+    return 1;
+}
+
+int razz_tailfile(char **args) {
+    ViewOptions opt;
+    if (parse_view_options(args, 1, &opt) != 0) {
+        return run_external_tool("tail", args);
+    }
+
+    char **files = &args[opt.first_file];
+    int nfiles = 0;
+    while (files[nfiles] != NULL) nfiles++;
+
+    if (nfiles == 0) {
+        if (isatty(STDIN_FILENO)) {
+            fprintf(stderr, "Usage: tailfile [-n lines | -c bytes] [-f] [filename...]\n");
+            return 1;
+        }
+        // Following a pipe is the same as reading it to the end
+        if (tail_fd(STDIN_FILENO, &opt) != 0 && errno != EPIPE) {
+            perror("tailfile");
+        }
+        return 1;
+    }
+
+    FollowTarget *targets = opt.follow ? calloc((size_t)nfiles, sizeof(FollowTarget)) : NULL;
+    for (int i = 0; targets && i < nfiles; i++) {
+        targets[i].name = files[i];
+        targets[i].fd = -1;
+    }
+    int printed = 0;
+    int last = -1;
+    int broken_pipe = 0;
+    for (int i = 0; i < nfiles; i++) {
+        int is_stdin = strcmp(files[i], "-") == 0;
+        int fd = is_stdin ? STDIN_FILENO : open(files[i], O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            fprintf(stderr, "tailfile: %s: %s\n", files[i], strerror(errno));
+            continue;
+        }
+        if (nfiles > 1) {
+            print_file_header(is_stdin ? "standard input" : files[i], &printed);
+            last = i;
+        }
+        int rc = tail_fd(fd, &opt);
+        int saved = errno;
+
+        struct stat st;
+        if (targets && !is_stdin && rc == 0 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+            targets[i].fd = fd;
+            targets[i].dev = st.st_dev;
+            targets[i].ino = st.st_ino;
+            targets[i].offset = lseek(fd, 0, SEEK_CUR);
+        } else if (!is_stdin) {
+            close(fd);
+        }
+        if (rc != 0) {
+            if (saved == EPIPE) {
+                broken_pipe = 1;
+                break;
+            }
+            fprintf(stderr, "tailfile: %s: %s\n", files[i], strerror(saved));
+        }
+    }
+    fflush(stdout);
+
+    if (targets) {
+        if (!broken_pipe) follow_files(targets, nfiles, last);
+        for (int i = 0; i < nfiles; i++) {
+            if (targets[i].fd >= 0) close(targets[i].fd);
+        }
+        free(targets);
+    }
+    return 1;
+}
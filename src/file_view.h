@@ -0,0 +1,23 @@
+#ifndef FILE_VIEW_H
+#define FILE_VIEW_H
+
+// Command: readfile (cat)
+// Streams files (or stdin) to stdout in-process, using splice/sendfile/
+// copy_file_range when the output type allows a zero-copy path
+int razz_readfile(char **args);
+
+// Command: headfile (head)
+// headfile [-n lines | -c bytes] [filename...]; stops reading once the
+// requested lines are out
+int razz_headfile(char **args);
+
+// Command: tailfile (tail)
+// tailfile [-n lines | -c bytes] [-f] [filename...]; regular files are
+// scanned backwards from EOF, -f follows each name through inotify and
+// survives truncation and rotation
+int razz_tailfile(char **args);
+
+// Copy everything readable from fd to stdout; returns 0 on success
+int file_view_stream_fd(int fd);
+
+#endif // FILE_VIEW_H
@@ -0,0 +1,306 @@
+#define _GNU_SOURCE
+#include "fs_walk.h"
+#include "thread_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/syscall.h>
+
+#define GETDENTS_BUF_SIZE (256 * 1024)
+// Every pending task pins its parent's fd, so keep this well below RLIMIT_NOFILE
+#define MAX_PENDING_TASKS 256
+
+// Record layout returned by getdents64(2)
+struct linux_dirent64 {
+    ino_t d_ino;
+    off_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+typedef struct {
+    const FsWalkOptions *opt;
+    FsWalkVisitFn visit;
+    void *ctx;
+    ThreadPool *pool;
+    dev_t root_dev;
+
+    pthread_mutex_t lock;   // serialises error output
+    atomic_int errors;
+    atomic_int stop;
+} WalkJob;
+
+// Directory fd shared by the children queued from it
+typedef struct {
+    int fd;
+    atomic_int refs;
+} DirHandle;
+
+// Post-order bookkeeping: a directory is finished once its own listing and
+// every queued subdirectory are done
+typedef struct WalkNode {
+    struct WalkNode *parent;
+    void *data;
+    atomic_int pending;
+} WalkNode;
+
+typedef struct {
+    WalkJob *job;
+    DirHandle *parent;   // NULL for the root
+    WalkNode *node;
+    char *path;
+    size_t name_off;     // where the last component starts in path
+    int depth;
+} DirTask;
+
+void fs_walk_options_init(FsWalkOptions *opt, const char *label) {
+    opt->max_depth = -1;
+    opt->nthreads = 0;
+    opt->same_device = 0;
+    opt->label = label;
+    opt->leave_dir = NULL;
+}
+
+int fs_walk_stat(const FsWalkEntry *entry, unsigned int mask, struct statx *out) {
+    const char *name = entry->dirfd == AT_FDCWD ? entry->path : entry->name;
+    return statx(entry->dirfd, name, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC, mask, out);
+}
+
+static void report_error(WalkJob *job, const char *path, int err) {
+    pthread_mutex_lock(&job->lock);
+    fprintf(stderr, "%s: %s: %s\n", job->opt->label, path, strerror(err));
+    pthread_mutex_unlock(&job->lock);
+    atomic_fetch_add(&job->errors, 1);
+}
+
+static void dir_handle_release(DirHandle *h) {
+    if (h && atomic_fetch_sub(&h->refs, 1) == 1) {
+        close(h->fd);
+        free(h);
+    }
+}
+
+static void walk_node_release(WalkJob *job, WalkNode *node) {
+    while (node && atomic_fetch_sub(&node->pending, 1) == 1) {
+        WalkNode *parent = node->parent;
+        if (job->opt->leave_dir && node->data) job->opt->leave_dir(node->data, job->ctx);
+        free(node);
+        node = parent;
+    }
+}
+
+// A directory that will not be read is finished straight away
+static void leave_unread(WalkJob *job, void *data) {
+    if (job->opt->leave_dir && data) job->opt->leave_dir(data, job->ctx);
+}
+
+static int may_descend(const WalkJob *job, int depth) {
+    return job->opt->max_depth < 0 || depth < job->opt->max_depth;
+}
+
+static void walk_dir_task(void *arg);
+
+static void queue_dir(WalkJob *job, DirHandle *parent, WalkNode *parent_node,
+                      const char *path, size_t name_off, int depth, void *data) {
+    DirTask *task = malloc(sizeof(DirTask));
+    WalkNode *node = malloc(sizeof(WalkNode));
+    char *copy = strdup(path);
+    if (!task || !node || !copy) {
+        free(task);
+        free(node);
+        free(copy);
+        report_error(job, path, ENOMEM);
+        leave_unread(job, data);
+        return;
+    }
+    node->parent = parent_node;
+    node->data = data;
+    atomic_init(&node->pending, 1);
+    if (parent_node) atomic_fetch_add(&parent_node->pending, 1);
+
+    task->job = job;
+    task->parent = parent;
+    task->node = node;
+    task->path = copy;
+    task->name_off = name_off;
+    task->depth = depth;
+    if (parent) atomic_fetch_add(&parent->refs, 1);
+
+    thread_pool_submit(job->pool, walk_dir_task, task);
+}
+
+static void walk_dir_task(void *arg) {
+    DirTask *task = arg;
+    WalkJob *job = task->job;
+    int fd = -1;
+
+    if (!atomic_load(&job->stop)) {
+        if (task->parent) {
+            fd = openat(task->parent->fd, task->path + task->name_off,
+                        O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        } else {
+            fd = open(task->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        }
+        if (fd < 0) report_error(job, task->path, errno);
+    }
+    dir_handle_release(task->parent);
+
+    if (fd >= 0 && job->opt->same_device) {
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_dev != job->root_dev) {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    DirHandle *self = NULL;
+    char *buf = NULL;
+    if (fd >= 0) {
+        self = malloc(sizeof(DirHandle));
+        buf = malloc(GETDENTS_BUF_SIZE);
+        if (!self || !buf) {
+            report_error(job, task->path, ENOMEM);
+            close(fd);
+            fd = -1;
+        } else {
+            self->fd = fd;
+            atomic_init(&self->refs, 1);
+        }
+    }
+
+    // Child paths are built in place after the directory's own path
+    size_t plen = strlen(task->path);
+    int need_sep = plen > 0 && task->path[plen - 1] != '/';
+    size_t base = plen + (size_t)need_sep;
+    size_t cap = base + 256;
+    char *path = fd >= 0 ? malloc(cap) : NULL;
+    if (path) {
+        memcpy(path, task->path, plen);
+        if (need_sep) path[plen] = '/';
+    }
+
+    while (path && !atomic_load(&job->stop)) {
+        long nread = syscall(SYS_getdents64, fd, buf, GETDENTS_BUF_SIZE);
+        if (nread < 0) {
+            report_error(job, task->path, errno);
+            break;
+        }
+        if (nread == 0) break;
+
+        for (long off = 0; off < nread && !atomic_load(&job->stop); ) {
+            struct linux_dirent64 *d = (struct linux_dirent64 *)(buf + off);
+            off += d->d_reclen;
+            const char *name = d->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+
+            size_t nlen = strlen(name);
+            if (base + nlen + 1 > cap) {
+                cap = (base + nlen + 1) * 2;
+                char *grown = realloc(path, cap);
+                if (!grown) {
+                    report_error(job, task->path, ENOMEM);
+                    continue;
+                }
+                path = grown;
+            }
+            memcpy(path + base, name, nlen + 1);
+
+            void *data = NULL;
+            FsWalkEntry entry = {
+                .path = path,
+                .name = path + base,
+                .dirfd = fd,
+                .type = d->d_type,
+                .depth = task->depth + 1,
+                .parent_data = task->node->data,
+                .data = &data
+            };
+            if (entry.type == DT_UNKNOWN) {
+                // Some filesystems leave d_type empty; one statx with the type bit fixes it
+                struct statx stx;
+                if (fs_walk_stat(&entry, STATX_TYPE, &stx) != 0) {
+                    report_error(job, path, errno);
+                    continue;
+                }
+                entry.type = IFTODT(stx.stx_mode);
+            }
+
+            if (entry.type != DT_DIR) entry.data = NULL;
+            int action = job->visit(&entry, job->ctx);
+            if (entry.type == DT_DIR && action == FS_WALK_CONTINUE && may_descend(job, entry.depth)) {
+                queue_dir(job, self, task->node, path, base, entry.depth, data);
+            } else {
+                leave_unread(job, data);
+            }
+            if (action == FS_WALK_STOP) {
+                atomic_store(&job->stop, 1);
+                break;
+            }
+        }
+    }
+
+    free(path);
+    free(buf);
+    if (self) dir_handle_release(self);
+    walk_node_release(job, task->node);
+    free(task->path);
+    free(task);
+}
+
+int fs_walk(const char *root, const FsWalkOptions *opt, FsWalkVisitFn visit, void *ctx) {
+    struct stat st;
+    if (lstat(root, &st) != 0) {
+        fprintf(stderr, "%s: %s: %s\n", opt->label, root, strerror(errno));
+        return -1;
+    }
+
+    WalkJob job;
+    job.opt = opt;
+    job.visit = visit;
+    job.ctx = ctx;
+    job.root_dev = st.st_dev;
+    pthread_mutex_init(&job.lock, NULL);
+    atomic_init(&job.errors, 0);
+    atomic_init(&job.stop, 0);
+
+    // The root keeps its spelling; its name is the last component
+    const char *name = root;
+    const char *slash = strrchr(root, '/');
+    if (slash && slash[1] != '\0') name = slash + 1;
+
+    void *data = NULL;
+    FsWalkEntry entry = {
+        .path = root,
+        .name = name,
+        .dirfd = AT_FDCWD,
+        .type = IFTODT(st.st_mode),
+        .depth = 0,
+        .parent_data = NULL,
+        .data = S_ISDIR(st.st_mode) ? &data : NULL
+    };
+    int action = visit(&entry, ctx);
+
+    if (entry.type == DT_DIR && action == FS_WALK_CONTINUE && may_descend(&job, 0)) {
+        job.pool = thread_pool_create(opt->nthreads, MAX_PENDING_TASKS);
+        if (job.pool) {
+            queue_dir(&job, NULL, NULL, root, 0, 0, data);
+            thread_pool_wait(job.pool);
+            thread_pool_destroy(job.pool);
+        } else {
+            report_error(&job, root, ENOMEM);
+            leave_unread(&job, data);
+        }
+    } else {
+        leave_unread(&job, data);
+    }
+
+    pthread_mutex_destroy(&job.lock);
+    return atomic_load(&job.errors);
+}
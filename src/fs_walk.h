@@ -0,0 +1,53 @@
+#ifndef FS_WALK_H
+#define FS_WALK_H
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+// Visitor return values
+#define FS_WALK_CONTINUE 0   // keep going (descend into directories)
+#define FS_WALK_SKIP     1   // do not descend into this directory
+#define FS_WALK_STOP     2   // abandon the whole walk
+
+// One directory entry as seen by the visitor. Everything here is only valid
+// for the duration of the callback.
+typedef struct {
+    const char *path;      // root operand joined with the relative path
+    const char *name;      // last path component
+    int dirfd;             // open fd of the containing directory (AT_FDCWD for roots)
+    unsigned char type;    // DT_* from getdents64, never DT_UNKNOWN
+    int depth;             // 0 for the root operand
+    void *parent_data;     // whatever the visitor attached to the containing directory
+    void **data;           // directories only: slot for the visitor's own per-directory value
+} FsWalkEntry;
+
+// Called concurrently from pool workers; the visitor does its own locking
+typedef int (*FsWalkVisitFn)(const FsWalkEntry *entry, void *ctx);
+
+// Called once a directory and everything below it has been visited, with the
+// value the visitor stored through entry->data (post-order, like nftw's FTW_DP)
+typedef void (*FsWalkLeaveFn)(void *dir_data, void *ctx);
+
+typedef struct {
+    int max_depth;          // deepest level visited, -1 for no limit
+    int nthreads;           // <= 0 picks the CPU count
+    int same_device;        // do not cross into other filesystems
+    const char *label;      // prefix for error messages, e.g. "searchfile"
+    FsWalkLeaveFn leave_dir; // optional post-order hook
+} FsWalkOptions;
+
+// Defaults: unlimited depth, one thread per CPU, crosses mounts
+void fs_walk_options_init(FsWalkOptions *opt, const char *label);
+
+// Walk root in parallel. Directories are read with getdents64 into large
+// buffers and handed out through the work-stealing pool; d_type avoids stat
+// calls, so nothing is stat'ed unless the visitor asks for it with
+// fs_walk_stat. Symlinks are reported but never followed. Returns -1 when
+// root cannot be read, otherwise the number of entries that failed.
+int fs_walk(const char *root, const FsWalkOptions *opt, FsWalkVisitFn visit, void *ctx);
+
+// statx the entry with only the fields in mask (STATX_SIZE, STATX_MTIME, ...)
+// without following symlinks. Returns 0 on success.
+int fs_walk_stat(const FsWalkEntry *entry, unsigned int mask, struct statx *out);
+
+#endif // FS_WALK_H
@@ -4,6 +4,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <unistd.h>
+#include <time.h>
+#include "out_sink.h"
+#include "proc_scan.h"
 
 // Trim whitespace from start and end
 static char* trim(char *str) {
@@ -17,49 +21,36 @@ static char* trim(char *str) {
 
 int razz_processes(char **args) {
     (void)args; // unused
-    
-    // We use popen to run 'ps' and format its output
-    FILE *fp = popen("ps -e 2>/dev/null || ps", "r");
-    if (!fp) {
-        perror("processes failed");
-        return 1;
-    }
-    
-    char line[512];
-    printf("%-10s %-20s\n", "PID", "NAME");
-    
-    // Skip header line from ps output
-    if (fgets(line, sizeof(line), fp) == NULL) {
-        pclose(fp);
+
+    ProcTable table;
+    if (proc_scan(&table, PROC_FIELD_NAME | PROC_FIELD_STAT | PROC_FIELD_USER) != 0) {
+        perror("processes: /proc");
         return 1;
     }
-    
-    // Read each process and print PID and Command Name
-    while (fgets(line, sizeof(line), fp)) {
-        // ps output columns: PID TTY TIME CMD or similar
-        // Let's tokenize by whitespace
-        char *pid_str = strtok(line, " \t\r\n");
-        if (!pid_str) continue;
-        
-        // Skip TTY and TIME (usually columns 1 and 2)
-        char *tty_str = strtok(NULL, " \t\r\n");
-        char *time_str = strtok(NULL, " \t\r\n");
-        (void)tty_str; // unused
-        (void)time_str; // unused
-        
-        char *cmd_str = strtok(NULL, " \t\r\n");
-        if (!cmd_str) continue;
-        
-        // Clean up command name (remove path/extensions if any)
-        char *base = strrchr(cmd_str, '/');
-        if (base) cmd_str = base + 1;
-        base = strrchr(cmd_str, '\\');
-        if (base) cmd_str = base + 1;
-        
-        printf("%-10s %-20s\n", pid_str, cmd_str);
+
+    OutSink out;
+    out_sink_open(&out, STDOUT_FILENO);
+    out_sink_printf(&out, "%-8s %-8s %-12s %-5s %6s %10s %-16s %s\n",
+                    "PID", "PPID", "USER", "STATE", "CPU", "RSS", "START", "NAME");
+
+    // Most processes start within the same few minutes, so reuse the last formatted time
+    time_t last_minute = -1;
+    char start[32] = "";
+    for (size_t i = 0; i < table.count && !out.failed; i++) {
+        const ProcRecord *p = &table.procs[i];
+        if (p->start_time / 60 != last_minute) {
+            struct tm tm;
+            last_minute = p->start_time / 60;
+            localtime_r(&p->start_time, &tm);
+            strftime(start, sizeof(start), "%Y-%m-%dT%H:%M", &tm);
+        }
+        out_sink_printf(&out, "%-8d %-8d %-12s %-5c %6.1f %10lu %-16s %s\n",
+                        (int)p->pid, (int)p->ppid, proc_user_name(p->uid), p->state,
+                        p->cpu_percent, p->rss_kb, start, p->name);
     }
-    
-    pclose(fp);
+
+    out_sink_close(&out);
+    proc_table_free(&table);
     return 1;
 }
 
@@ -2,7 +2,8 @@
 #define OBJECT_PIPELINE_H
 
 // Command: processes
-// Lists running processes in structured table format (PID NAME)
+// Lists running processes in structured table format
+// (PID PPID USER STATE CPU RSS START NAME), read natively from /proc
 int razz_processes(char **args);
 
 // Command: where
@@ -0,0 +1,151 @@
+#define _GNU_SOURCE
+#include "out_sink.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <stdatomic.h>
+
+#define SINK_TTY_CHUNK    (16 * 1024)
+#define SINK_PIPE_CHUNK   (64 * 1024)
+#define SINK_FILE_CHUNK   (256 * 1024)
+#define SINK_GATHER_MIN   (8 * 1024)    // blocks at least this big are not copied
+
+static atomic_ullong total_requests;
+static atomic_ullong total_syscalls;
+
+static size_t pick_chunk(int fd, int *is_tty) {
+    *is_tty = isatty(fd);
+    if (*is_tty) return SINK_TTY_CHUNK;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode)) {
+        // Writes up to the pipe's capacity do not block half way
+        int size = fcntl(fd, F_GETPIPE_SZ);
+        return size > 0 ? (size_t)size : SINK_PIPE_CHUNK;
+    }
+    return SINK_FILE_CHUNK;
+}
+
+void out_sink_open(OutSink *sink, int fd) {
+    fflush(stdout);
+    memset(sink, 0, sizeof(OutSink));
+    sink->fd = fd;
+    sink->flush_at = pick_chunk(fd, &sink->is_tty);
+}
+
+// Write every iovec fully, retrying short writes
+static int write_vec(OutSink *sink, struct iovec *iov, int n) {
+    while (n > 0) {
+        ssize_t w = writev(sink->fd, iov, n);
+        sink->syscalls++;
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            sink->failed = 1;
+            return -1;
+        }
+        while (n > 0 && (size_t)w >= iov->iov_len) {
+            w -= (ssize_t)iov->iov_len;
+            iov++;
+            n--;
+        }
+        if (n > 0) {
+            iov->iov_base = (char *)iov->iov_base + w;
+            iov->iov_len -= (size_t)w;
+        }
+    }
+    return 0;
+}
+
+int out_sink_flush(OutSink *sink) {
+    if (sink->len > 0 && !sink->failed) {
+        struct iovec iov = { sink->buf, sink->len };
+        write_vec(sink, &iov, 1);
+    }
+    sink->len = 0;
+    return sink->failed ? -1 : 0;
+}
+
+static int reserve(OutSink *sink, size_t extra) {
+    if (sink->len + extra <= sink->cap) return 0;
+    size_t cap = sink->cap ? sink->cap : sink->flush_at + 1024;
+    while (cap < sink->len + extra) cap *= 2;
+    char *grown = realloc(sink->buf, cap);
+    if (!grown) return -1;
+    sink->buf = grown;
+    sink->cap = cap;
+    return 0;
+}
+
+void out_sink_write(OutSink *sink, const void *data, size_t len) {
+    sink->requests++;
+    if (sink->failed || len == 0) return;
+
+    if (len >= SINK_GATHER_MIN) {
+        struct iovec iov[2] = { { sink->buf, sink->len }, { (void *)data, len } };
+        int first = sink->len > 0 ? 0 : 1;
+        write_vec(sink, iov + first, 2 - first);
+        sink->len = 0;
+        return;
+    }
+    if (reserve(sink, len) != 0) {
+        out_sink_flush(sink);
+        struct iovec iov = { (void *)data, len };
+        write_vec(sink, &iov, 1);
+        return;
+    }
+    memcpy(sink->buf + sink->len, data, len);
+    sink->len += len;
+    if (sink->len >= sink->flush_at) out_sink_flush(sink);
+}
+
+void out_sink_puts(OutSink *sink, const char *str) {
+    out_sink_write(sink, str, strlen(str));
+}
+
+void out_sink_printf(OutSink *sink, const char *fmt, ...) {
+    sink->requests++;
+    if (sink->failed) return;
+
+    va_list ap;
+    for (int attempt = 0; attempt < 2; attempt++) {
+        size_t room = sink->cap - sink->len;
+        va_start(ap, fmt);
+        int n = vsnprintf(sink->buf ? sink->buf + sink->len : NULL, room, fmt, ap);
+        va_end(ap);
+        if (n < 0) return;
+        if ((size_t)n < room) {
+            sink->len += (size_t)n;
+            if (sink->len >= sink->flush_at) out_sink_flush(sink);
+            return;
+        }
+        if (reserve(sink, (size_t)n + 1) != 0) return;
+    }
+}
+
+int out_sink_close(OutSink *sink) {
+    int rc = out_sink_flush(sink);
+    free(sink->buf);
+    sink->buf = NULL;
+    sink->cap = 0;
+
+    atomic_fetch_add(&total_requests, sink->requests);
+    atomic_fetch_add(&total_syscalls, sink->syscalls);
+    if (getenv("RAZZSHELL_SINK_STATS")) {
+        fprintf(stderr, "out_sink: fd %d (%s): %lu writes in %lu syscalls, %llu saved so far\n",
+                sink->fd, sink->is_tty ? "tty" : "non-tty", sink->requests, sink->syscalls,
+                out_sink_syscalls_saved());
+    }
+    return rc;
+}
+
+unsigned long long out_sink_syscalls_saved(void) {
+    unsigned long long req = atomic_load(&total_requests);
+    unsigned long long sys = atomic_load(&total_syscalls);
+    return req > sys ? req - sys : 0;
+}
@@ -0,0 +1,46 @@
+#ifndef OUT_SINK_H
+#define OUT_SINK_H
+
+#include <stddef.h>
+
+// Buffered output for builtins. Rows are formatted into one large buffer and
+// reach the fd in as few write/writev calls as possible, instead of one
+// stdio write per printf. The flush threshold depends on what the fd is: a
+// terminal gets smaller chunks so long output still scrolls promptly, a pipe
+// gets its own capacity, and regular files get large writes.
+typedef struct {
+    int fd;
+    int is_tty;
+    int failed;              // a write failed (e.g. EPIPE); later output is dropped
+    char *buf;
+    size_t len;
+    size_t cap;
+    size_t flush_at;
+    unsigned long requests;  // writes the caller asked for
+    unsigned long syscalls;  // writes actually issued
+} OutSink;
+
+// Start a sink on fd. Flushes stdio first so earlier printf output lands
+// before anything written through the sink.
+void out_sink_open(OutSink *sink, int fd);
+
+void out_sink_printf(OutSink *sink, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+void out_sink_puts(OutSink *sink, const char *str);
+
+// Large blocks are not copied: they go out together with whatever is
+// buffered in a single writev
+void out_sink_write(OutSink *sink, const void *data, size_t len);
+
+// Explicit flush point, e.g. before sleeping or waiting on other work.
+// Returns -1 once a write has failed.
+int out_sink_flush(OutSink *sink);
+
+// Flush and release the buffer. Returns -1 if any write failed.
+int out_sink_close(OutSink *sink);
+
+// Debug counter: writes absorbed by all sinks so far minus the syscalls they
+// needed. Setting RAZZSHELL_SINK_STATS prints per-sink figures on close.
+unsigned long long out_sink_syscalls_saved(void);
+
+#endif // OUT_SINK_H
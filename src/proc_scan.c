@@ -0,0 +1,316 @@
+#define _GNU_SOURCE
+#include "proc_scan.h"
+#include "thread_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pwd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#define PROC_DENTS_SIZE  (64 * 1024)
+#define PROC_READ_SIZE   4096
+#define PROC_CHUNK       128      // pids per pool task
+#define USER_CACHE_SLOTS 256
+
+// Record layout returned by getdents64(2)
+struct linux_dirent64 {
+    ino_t d_ino;
+    off_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+typedef struct {
+    int procfd;
+    unsigned fields;
+    ProcRecord *procs;
+    double uptime;
+    time_t boot_time;
+    long hz;
+    unsigned long page_kb;
+} ScanJob;
+
+typedef struct {
+    ScanJob *job;
+    size_t start;
+    size_t end;
+} ScanChunk;
+
+typedef struct {
+    uid_t uid;
+    char *name;   // NULL for an empty slot
+} UserSlot;
+
+static UserSlot user_cache[USER_CACHE_SLOTS];
+
+// Read a small /proc file into buf (NUL-terminated). Returns the length or -1.
+static ssize_t read_proc_file(int procfd, pid_t pid, const char *file, char *buf, size_t size) {
+    char path[64];
+    snprintf(path, sizeof(path), "%d/%s", (int)pid, file);
+    int fd = openat(procfd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    ssize_t n;
+    do {
+        n = read(fd, buf, size - 1);
+    } while (n < 0 && errno == EINTR);
+    close(fd);
+    if (n < 0) return -1;
+    buf[n] = '\0';
+    return n;
+}
+
+static const char* skip_fields(const char *p, int count) {
+    while (count-- > 0 && *p) {
+        while (*p == ' ') p++;
+        while (*p && *p != ' ') p++;
+    }
+    while (*p == ' ') p++;
+    return p;
+}
+
+static int parse_stat(ProcRecord *r, char *buf, const ScanJob *job) {
+    // comm may itself contain spaces and parentheses, so it ends at the last ')'
+    char *open = strchr(buf, '(');
+    char *close = strrchr(buf, ')');
+    if (!open || !close || close < open) return -1;
+    size_t len = (size_t)(close - open - 1);
+    if (len >= sizeof(r->name)) len = sizeof(r->name) - 1;
+    memcpy(r->name, open + 1, len);
+    r->name[len] = '\0';
+
+    // Fields after comm, numbered as in proc(5) starting at 3 (state)
+    const char *p = close + 2;
+    r->state = *p;
+    p = skip_fields(p, 1);
+    r->ppid = (pid_t)strtol(p, NULL, 10);
+    p = skip_fields(p, 3);                         // ppid, pgrp, session
+    r->tty_nr = (int)strtol(p, NULL, 10);
+    p = skip_fields(p, 7);                         // tty_nr .. cmajflt
+    char *end;
+    unsigned long long utime = strtoull(p, &end, 10);
+    unsigned long long stime = strtoull(end, &end, 10);
+    r->cpu_ticks = utime + stime;
+    p = skip_fields(end, 6);                       // cutime .. itrealvalue
+    r->start_ticks = strtoull(p, &end, 10);
+    p = skip_fields(end, 1);                       // vsize
+    unsigned long rss_pages = strtoul(p, NULL, 10);
+    r->rss_kb = rss_pages * job->page_kb;
+
+    double started = (double)r->start_ticks / job->hz;
+    r->start_time = job->boot_time + (time_t)started;
+    double elapsed = job->uptime - started;
+    r->cpu_percent = elapsed > 0 ? 100.0 * ((double)r->cpu_ticks / job->hz) / elapsed : 0.0;
+    return 0;
+}
+
+static int read_record(ScanJob *job, ProcRecord *r, char *buf) {
+    if (job->fields & PROC_FIELD_STAT) {
+        // stat carries comm as well, so name costs nothing extra here
+        if (read_proc_file(job->procfd, r->pid, "stat", buf, PROC_READ_SIZE) < 0) return -1;
+        if (parse_stat(r, buf, job) != 0) return -1;
+    } else if (job->fields & PROC_FIELD_NAME) {
+        ssize_t n = read_proc_file(job->procfd, r->pid, "comm", buf, PROC_READ_SIZE);
+        if (n < 0) return -1;
+        if (n > 0 && buf[n - 1] == '\n') buf[--n] = '\0';
+        snprintf(r->name, sizeof(r->name), "%s", buf);
+    }
+
+    if (job->fields & PROC_FIELD_USER) {
+        char path[32];
+        struct stat st;
+        snprintf(path, sizeof(path), "%d", (int)r->pid);
+        if (fstatat(job->procfd, path, &st, 0) != 0) return -1;
+        r->uid = st.st_uid;
+    }
+
+    if (job->fields & PROC_FIELD_CMDLINE) {
+        ssize_t n = read_proc_file(job->procfd, r->pid, "cmdline", buf, PROC_READ_SIZE);
+        if (n > 0) {
+            // Arguments are NUL-separated; the last one is NUL-terminated
+            while (n > 0 && buf[n - 1] == '\0') n--;
+            for (ssize_t i = 0; i < n; i++) {
+                if (buf[i] == '\0') buf[i] = ' ';
+            }
+            r->cmdline = strndup(buf, (size_t)n);
+        }
+    }
+    return 0;
+}
+
+static void scan_chunk(void *arg) {
+    ScanChunk *chunk = arg;
+    char buf[PROC_READ_SIZE];
+    for (size_t i = chunk->start; i < chunk->end; i++) {
+        ProcRecord *r = &chunk->job->procs[i];
+        // A process that exited while we were scanning is dropped afterwards
+        if (read_record(chunk->job, r, buf) != 0) {
+            free(r->cmdline);
+            r->cmdline = NULL;
+            r->pid = 0;
+        }
+    }
+}
+
+static ThreadPool* scan_pool(void) {
+    static ThreadPool *pool = NULL;
+    if (!pool) pool = thread_pool_create(0, 256);
+    return pool;
+}
+
+// Uptime, boot time and MemTotal; only needed when stat fields are read
+static void read_system_times(ScanJob *job, ProcTable *table) {
+    char buf[PROC_READ_SIZE];
+    int fd = openat(job->procfd, "uptime", O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        ssize_t n = read(fd, buf, sizeof(buf) - 1);
+        if (n > 0) {
+            buf[n] = '\0';
+            job->uptime = strtod(buf, NULL);
+        }
+        close(fd);
+    }
+    job->boot_time = time(NULL) - (time_t)job->uptime;
+
+    FILE *meminfo = fopen("/proc/meminfo", "r");
+    if (meminfo) {
+        char line[256];
+        while (fgets(line, sizeof(line), meminfo)) {
+            if (sscanf(line, "MemTotal: %lu", &table->total_mem_kb) == 1) break;
+        }
+        fclose(meminfo);
+    }
+}
+
+static int compare_pids(const void *a, const void *b) {
+    pid_t x = ((const ProcRecord *)a)->pid;
+    pid_t y = ((const ProcRecord *)b)->pid;
+    return (x > y) - (x < y);
+}
+
+int proc_scan(ProcTable *table, unsigned fields) {
+    memset(table, 0, sizeof(ProcTable));
+    table->ticks_per_sec = sysconf(_SC_CLK_TCK);
+
+    int procfd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (procfd < 0) return -1;
+
+    // Collect the numeric entries first; they become the record slots
+    size_t cap = 1024;
+    table->procs = malloc(cap * sizeof(ProcRecord));
+    char *dents = malloc(PROC_DENTS_SIZE);
+    if (!table->procs || !dents) {
+        free(dents);
+        close(procfd);
+        proc_table_free(table);
+        return -1;
+    }
+    long nread;
+    int sorted = 1;
+    while ((nread = syscall(SYS_getdents64, procfd, dents, PROC_DENTS_SIZE)) > 0) {
+        for (long off = 0; off < nread; ) {
+            struct linux_dirent64 *d = (struct linux_dirent64 *)(dents + off);
+            off += d->d_reclen;
+            if (d->d_name[0] < '1' || d->d_name[0] > '9') continue;
+
+            if (table->count == cap) {
+                ProcRecord *grown = realloc(table->procs, cap * 2 * sizeof(ProcRecord));
+                if (!grown) break;
+                table->procs = grown;
+                cap *= 2;
+            }
+            ProcRecord *r = &table->procs[table->count];
+            memset(r, 0, sizeof(ProcRecord));
+            r->pid = (pid_t)atoi(d->d_name);
+            if (table->count > 0 && r->pid < table->procs[table->count - 1].pid) sorted = 0;
+            table->count++;
+        }
+    }
+    free(dents);
+
+    ScanJob job = { procfd, fields, table->procs, 0.0, 0, table->ticks_per_sec,
+                    (unsigned long)sysconf(_SC_PAGESIZE) / 1024 };
+    if (fields & PROC_FIELD_STAT) read_system_times(&job, table);
+
+    size_t nchunks = (table->count + PROC_CHUNK - 1) / PROC_CHUNK;
+    ScanChunk *chunks = calloc(nchunks ? nchunks : 1, sizeof(ScanChunk));
+    ThreadPool *pool = nchunks > 1 ? scan_pool() : NULL;
+    for (size_t c = 0; chunks && c < nchunks; c++) {
+        chunks[c].job = &job;
+        chunks[c].start = c * PROC_CHUNK;
+        chunks[c].end = (c + 1) * PROC_CHUNK < table->count ? (c + 1) * PROC_CHUNK : table->count;
+        if (pool) thread_pool_submit(pool, scan_chunk, &chunks[c]);
+        else scan_chunk(&chunks[c]);
+    }
+    if (pool) thread_pool_wait(pool);
+    free(chunks);
+    close(procfd);
+
+    // Drop processes that vanished mid-scan
+    size_t kept = 0;
+    for (size_t i = 0; i < table->count; i++) {
+        if (table->procs[i].pid != 0) table->procs[kept++] = table->procs[i];
+    }
+    table->count = kept;
+    if (!sorted) qsort(table->procs, table->count, sizeof(ProcRecord), compare_pids);
+    return 0;
+}
+
+void proc_table_free(ProcTable *table) {
+    for (size_t i = 0; table->procs && i < table->count; i++) {
+        free(table->procs[i].cmdline);
+    }
+    free(table->procs);
+    table->procs = NULL;
+    table->count = 0;
+}
+
+const ProcRecord* proc_table_find(const ProcTable *table, pid_t pid) {
+    size_t lo = 0, hi = table->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (table->procs[mid].pid == pid) return &table->procs[mid];
+        if (table->procs[mid].pid < pid) lo = mid + 1;
+        else hi = mid;
+    }
+    return NULL;
+}
+
+const char* proc_user_name(uid_t uid) {
+    unsigned slot = ((unsigned)uid * 2654435761u) % USER_CACHE_SLOTS;
+    for (int probe = 0; probe < USER_CACHE_SLOTS; probe++) {
+        UserSlot *s = &user_cache[(slot + probe) % USER_CACHE_SLOTS];
+        if (s->name && s->uid == uid) return s->name;
+        if (!s->name) {
+            struct passwd *pw = getpwuid(uid);
+            char num[16];
+            snprintf(num, sizeof(num), "%u", (unsigned)uid);
+            s->name = strdup(pw ? pw->pw_name : num);
+            s->uid = uid;
+            return s->name ? s->name : "?";
+        }
+    }
+    // Cache full: look it up every time
+    struct passwd *pw = getpwuid(uid);
+    return pw ? pw->pw_name : "?";
+}
+
+void proc_tty_name(int tty_nr, char *buf, size_t len) {
+    unsigned major = ((unsigned)tty_nr >> 8) & 0xfff;
+    unsigned minor = ((unsigned)tty_nr & 0xff) | (((unsigned)tty_nr >> 12) & 0xfff00);
+    if (tty_nr == 0) {
+        snprintf(buf, len, "?");
+    } else if (major >= 136 && major <= 143) {
+        snprintf(buf, len, "pts/%u", minor + (major - 136) * 256);
+    } else if (major == 4 && minor < 64) {
+        snprintf(buf, len, "tty%u", minor);
+    } else if (major == 4) {
+        snprintf(buf, len, "ttyS%u", minor - 64);
+    } else {
+        snprintf(buf, len, "?");
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef PROC_SCAN_H
+#define PROC_SCAN_H
+
+#include <sys/types.h>
+#include <time.h>
+
+// Which parts of each process to read. Anything not asked for is left zeroed
+// and costs no syscalls.
+#define PROC_FIELD_NAME    0x01   // name (from comm, or from stat when that is read anyway)
+#define PROC_FIELD_STAT    0x02   // ppid, state, tty, cpu ticks, rss, start time
+#define PROC_FIELD_USER    0x04   // owner uid (one fstatat on /proc/[pid])
+#define PROC_FIELD_CMDLINE 0x08   // full command line, for ps -ef style output
+#define PROC_FIELD_ALL     0x0f
+
+// One process as read from /proc
+typedef struct {
+    pid_t pid;
+    pid_t ppid;
+    char state;                    // R, S, D, Z, ...
+    char name[16];                 // comm, at most 15 characters
+    uid_t uid;
+    int tty_nr;                    // controlling terminal as encoded by the kernel, 0 for none
+    unsigned long long cpu_ticks;  // utime + stime in clock ticks
+    unsigned long rss_kb;
+    unsigned long long start_ticks; // since boot
+    time_t start_time;             // wall clock
+    double cpu_percent;            // cpu time over lifetime, like ps %CPU
+    char *cmdline;                 // PROC_FIELD_CMDLINE only; NULL for kernel threads
+} ProcRecord;
+
+typedef struct {
+    ProcRecord *procs;             // sorted by pid
+    size_t count;
+    unsigned long total_mem_kb;    // MemTotal, for %MEM
+    long ticks_per_sec;
+} ProcTable;
+
+// Scan every process in parallel: /proc is listed with getdents64 and each
+// worker reads its share with openat relative to the /proc fd into one
+// reused buffer. Processes that exit mid-scan are dropped. Returns 0, or -1
+// if /proc cannot be read.
+int proc_scan(ProcTable *table, unsigned fields);
+
+void proc_table_free(ProcTable *table);
+
+// Binary search by pid; NULL if the process was not in the scan
+const ProcRecord* proc_table_find(const ProcTable *table, pid_t pid);
+
+// Cached user name for a uid (the number as text when it has no passwd entry)
+const char* proc_user_name(uid_t uid);
+
+// Terminal name for tty_nr, e.g. "pts/3", or "?" for none
+void proc_tty_name(int tty_nr, char *buf, size_t len);
+
+#endif // PROC_SCAN_H
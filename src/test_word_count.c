@@ -0,0 +1,85 @@
+#include "word_count.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures = 0;
+
+// Byte-at-a-time reference counter
+static WordCounts reference_count(const char *buf, size_t len) {
+    WordCounts wc = {0, 0, len, 0};
+    int prev_space = 1;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)buf[i];
+        int space = (c == ' ' || (c >= '\t' && c <= '\r'));
+        if (c == '\n') wc.lines++;
+        if (!space && prev_space) wc.words++;
+        if ((c & 0xC0) != 0x80) wc.chars++;
+        prev_space = space;
+    }
+    return wc;
+}
+
+void test_word_count(const char *label, const char *buf, size_t len) {
+    WordCounts expected = reference_count(buf, len);
+    WordCounts whole = {0, 0, 0, 0};
+    word_count_buffer(buf, len, 1, &whole);
+
+    // Counting in two halves must merge to the same totals
+    WordCounts split = {0, 0, 0, 0};
+    size_t mid = len / 2;
+    word_count_buffer(buf, mid, 1, &split);
+    int prev_space = mid == 0 ? 1 : (buf[mid - 1] == ' ' || (buf[mid - 1] >= '\t' && buf[mid - 1] <= '\r'));
+    word_count_buffer(buf + mid, len - mid, prev_space, &split);
+
+    int ok = memcmp(&expected, &whole, sizeof(WordCounts)) == 0 &&
+             memcmp(&expected, &split, sizeof(WordCounts)) == 0;
+    printf("%-28s lines=%zu words=%zu chars=%zu bytes=%zu  %s\n", label,
+           whole.lines, whole.words, whole.chars, whole.bytes, ok ? "PASS" : "FAIL");
+    if (!ok) failures++;
+}
+
+int main() {
+    printf("RazzShell Word Count Test Suite\n");
+    printf("===============================\n");
+
+    // Test 1: Empty input
+    test_word_count("empty", "", 0);
+
+    // Test 2: Single word without newline
+    test_word_count("single word", "hello", 5);
+
+    // Test 3: Mixed whitespace
+    const char *ws = "  one\ttwo\r\nthree \v four\f five\n\n";
+    test_word_count("mixed whitespace", ws, strlen(ws));
+
+    // Test 4: UTF-8 text crossing 16-byte blocks
+    const char *utf8 = "héllo wörld 日本語 テキスト ünïcödé\nzweite Zeile\n";
+    test_word_count("utf-8", utf8, strlen(utf8));
+
+    // Test 5: Word spanning a block boundary
+    const char *span = "aaaaaaaaaaaaaaabbbbbbbbbbbbbbbbb ccccccccccccccccc\n";
+    test_word_count("block boundary", span, strlen(span));
+
+    // Test 6: Pseudo-random buffer
+    size_t len = 100000;
+    char *buf = malloc(len);
+    unsigned seed = 12345;
+    const char alphabet[] = "ab \n\t\xc3\xa9xyz \r";
+    for (size_t i = 0; i < len; i++) {
+        seed = seed * 1103515245 + 12345;
+        buf[i] = alphabet[(seed >> 16) % (sizeof(alphabet) - 1)];
+    }
+    test_word_count("random 100k", buf, len);
+    free(buf);
+
+    printf("\n========================================\n");
+    if (failures) {
+        printf("%d test(s) failed!\n", failures);
+    } else {
+        printf("All tests complete!\n");
+    }
+    printf("========================================\n");
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,992 @@
+#define _GNU_SOURCE
+#include "text_search.h"
+#include "thread_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <fnmatch.h>
+#include <regex.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
+#define READ_CHUNK        (1024 * 1024)
+#define MMAP_THRESHOLD    (128 * 1024)
+#define BINARY_PROBE      (64 * 1024)
+#define FLUSH_THRESHOLD   (1024 * 1024)
+#define MAX_PENDING_TASKS 512
+
+#define COLOR_FILE  "\033[35m"
+#define COLOR_LINE  "\033[32m"
+#define COLOR_MATCH "\033[1;31m"
+#define COLOR_SEP   "\033[36m"
+#define COLOR_RESET "\033[0m"
+
+// ---------------------------------------------------------------------------
+// Literal search
+// ---------------------------------------------------------------------------
+
+// Rough byte frequency in source code and logs; lower means rarer
+static int byte_rank(unsigned char c) {
+    static const char common[] = " etaoinsrhldcumfpgwybvkxjqz";
+    if (c >= 'A' && c <= 'Z') c = (unsigned char)tolower(c);
+    const char *p = (c != '\0') ? strchr(common, c) : NULL;
+    if (p) return 255 - (int)(p - common) * 4;
+    if (c >= '0' && c <= '9') return 140;
+    if (strchr("_.-/(){};,=\"'\n\t", c) && c != '\0') return 130;
+    return 40;
+}
+
+// Pick the two rarest distinct offsets of the needle for the SIMD prefilter
+static void pick_rare_offsets(const char *needle, size_t len, size_t *r1, size_t *r2) {
+    *r1 = 0;
+    for (size_t i = 1; i < len; i++) {
+        if (byte_rank((unsigned char)needle[i]) < byte_rank((unsigned char)needle[*r1])) *r1 = i;
+    }
+    *r2 = (*r1 == len - 1) ? 0 : len - 1;
+    for (size_t i = 0; i < len; i++) {
+        if (i == *r1) continue;
+        if (byte_rank((unsigned char)needle[i]) < byte_rank((unsigned char)needle[*r2])) *r2 = i;
+    }
+    if (len == 1) *r2 = 0;
+}
+
+static int mem_equal_nocase(const char *a, const char *b, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i])) return 0;
+    }
+    return 1;
+}
+
+static int verify_at(const char *p, const char *needle, size_t len, int ignore_case) {
+    return ignore_case ? mem_equal_nocase(p, needle, len) : memcmp(p, needle, len) == 0;
+}
+
+static const char* find_with_offsets(const char *hay, size_t hay_len,
+                                     const char *needle, size_t len,
+                                     size_t r1, size_t r2, int ignore_case) {
+    if (len == 0) return hay;
+    if (hay_len < len) return NULL;
+
+    if (len == 1 && !ignore_case) return memchr(hay, needle[0], hay_len);
+
+    size_t last = hay_len - len; // last valid candidate start
+    size_t i = 0;
+
+#ifdef __SSE2__
+    // Compare the two rare bytes at every candidate of a 16-byte window,
+    // then verify only the candidates where both line up
+    unsigned char c1 = (unsigned char)needle[r1];
+    unsigned char c2 = (unsigned char)needle[r2];
+    __m128i lo1 = _mm_set1_epi8((char)tolower(c1));
+    __m128i up1 = _mm_set1_epi8((char)toupper(c1));
+    __m128i lo2 = _mm_set1_epi8((char)tolower(c2));
+    __m128i up2 = _mm_set1_epi8((char)toupper(c2));
+    __m128i ex1 = _mm_set1_epi8((char)c1);
+    __m128i ex2 = _mm_set1_epi8((char)c2);
+    size_t rmax = r1 > r2 ? r1 : r2;
+
+    while (i + rmax + 16 <= hay_len && i <= last) {
+        __m128i b1 = _mm_loadu_si128((const __m128i *)(hay + i + r1));
+        __m128i b2 = _mm_loadu_si128((const __m128i *)(hay + i + r2));
+        __m128i m1, m2;
+        if (ignore_case) {
+            m1 = _mm_or_si128(_mm_cmpeq_epi8(b1, lo1), _mm_cmpeq_epi8(b1, up1));
+            m2 = _mm_or_si128(_mm_cmpeq_epi8(b2, lo2), _mm_cmpeq_epi8(b2, up2));
+        } else {
+            m1 = _mm_cmpeq_epi8(b1, ex1);
+            m2 = _mm_cmpeq_epi8(b2, ex2);
+        }
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(m1, m2));
+        while (mask) {
+            size_t cand = i + (size_t)__builtin_ctz(mask);
+            if (cand > last) return NULL;
+            if (verify_at(hay + cand, needle, len, ignore_case)) return hay + cand;
+            mask &= mask - 1;
+        }
+        i += 16;
+    }
+#else
+    (void)r2;
+#endif
+
+    // Scalar tail (or whole buffer without SSE2): memchr on the rare byte
+    unsigned char rare = (unsigned char)needle[r1];
+    while (i <= last) {
+        if (!ignore_case) {
+            const char *p = memchr(hay + i + r1, rare, last - i + 1);
+            if (!p) return NULL;
+            size_t cand = (size_t)(p - hay) - r1;
+            if (verify_at(hay + cand, needle, len, 0)) return hay + cand;
+            i = cand + 1;
+        } else {
+            if (tolower((unsigned char)hay[i + r1]) == tolower(rare) &&
+                verify_at(hay + i, needle, len, 1)) {
+                return hay + i;
+            }
+            i++;
+        }
+    }
+    return NULL;
+}
+
+const char* text_search_find(const char *hay, size_t hay_len,
+                             const char *needle, size_t needle_len, int ignore_case) {
+    if (needle_len == 0) return hay;
+    size_t r1, r2;
+    pick_rare_offsets(needle, needle_len, &r1, &r2);
+    return find_with_offsets(hay, hay_len, needle, needle_len, r1, r2, ignore_case);
+}
+
+static size_t count_newlines(const char *p, const char *end) {
+    size_t count = 0;
+#ifdef __SSE2__
+    __m128i nl = _mm_set1_epi8('\n');
+    while (p + 16 <= end) {
+        __m128i b = _mm_loadu_si128((const __m128i *)p);
+        count += (size_t)__builtin_popcount((unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(b, nl)));
+        p += 16;
+    }
+#endif
+    while (p < end) {
+        const char *q = memchr(p, '\n', (size_t)(end - p));
+        if (!q) break;
+        count++;
+        p = q + 1;
+    }
+    return count;
+}
+
+// ---------------------------------------------------------------------------
+// Job state and output
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} OutBuf;
+
+typedef struct {
+    // Options
+    int ignore_case;
+    int line_numbers;
+    int invert;
+    int count_only;
+    int files_only;
+    int recursive;
+    int table;
+    int color;
+    int show_names;
+
+    // Compiled pattern
+    int use_regex;
+    regex_t regex;
+    char *literal;          // required literal (whole pattern or regex prefilter)
+    size_t lit_len;
+    size_t rare1;
+    size_t rare2;
+
+    ThreadPool *pool;
+    pthread_mutex_t out_lock;
+
+    // Results for explicit operands are released in argument order
+    OutBuf **slots;
+    int *slot_done;
+    int slot_count;
+    int next_slot;
+} SearchJob;
+
+// Per-file scanning state
+typedef struct {
+    const char *name;
+    size_t lines_before;    // newlines preceding the current buffer
+    size_t matches;
+    int binary;
+    int done;
+    int holding_output;     // this file owns stdout until it finishes
+    int streaming;          // write after every chunk (stdin in a pipeline)
+    OutBuf out;
+} FileScan;
+
+static void ob_reserve(OutBuf *ob, size_t extra) {
+    if (ob->len + extra <= ob->cap) return;
+    size_t cap = ob->cap ? ob->cap : 4096;
+    while (cap < ob->len + extra) cap *= 2;
+    char *grown = realloc(ob->data, cap);
+    if (!grown) return;
+    ob->data = grown;
+    ob->cap = cap;
+}
+
+static void ob_append(OutBuf *ob, const char *s, size_t n) {
+    ob_reserve(ob, n);
+    if (ob->len + n > ob->cap) return;
+    memcpy(ob->data + ob->len, s, n);
+    ob->len += n;
+}
+
+static void ob_puts(OutBuf *ob, const char *s) {
+    ob_append(ob, s, strlen(s));
+}
+
+static void ob_number(OutBuf *ob, size_t v) {
+    char tmp[32];
+    int n = snprintf(tmp, sizeof(tmp), "%zu", v);
+    ob_append(ob, tmp, (size_t)n);
+}
+
+static void write_out(const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(STDOUT_FILENO, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+// Large unordered outputs are streamed, keeping the file's lines contiguous
+static void maybe_flush(SearchJob *job, FileScan *fs, int ordered) {
+    if (ordered || fs->out.len < FLUSH_THRESHOLD) return;
+    if (!fs->holding_output) {
+        pthread_mutex_lock(&job->out_lock);
+        fs->holding_output = 1;
+    }
+    write_out(fs->out.data, fs->out.len);
+    fs->out.len = 0;
+}
+
+static void emit_match(SearchJob *job, FileScan *fs, size_t line_no,
+                       const char *line, size_t line_len, size_t col, size_t match_len) {
+    fs->matches++;
+    if (job->files_only) {
+        fs->done = 1;
+        return;
+    }
+    if (job->count_only || fs->binary) return;
+
+    OutBuf *ob = &fs->out;
+    if (job->table) {
+        ob_puts(ob, fs->name);
+        ob_append(ob, " ", 1);
+        ob_number(ob, line_no);
+        ob_append(ob, " ", 1);
+        ob_number(ob, col + 1);
+        ob_append(ob, " ", 1);
+        ob_append(ob, line, line_len);
+        ob_append(ob, "\n", 1);
+        return;
+    }
+
+    if (job->show_names) {
+        if (job->color) ob_puts(ob, COLOR_FILE);
+        ob_puts(ob, fs->name);
+        ob_puts(ob, job->color ? COLOR_SEP ":" COLOR_RESET : ":");
+    }
+    if (job->line_numbers) {
+        if (job->color) ob_puts(ob, COLOR_LINE);
+        ob_number(ob, line_no);
+        ob_puts(ob, job->color ? COLOR_SEP ":" COLOR_RESET : ":");
+    }
+    if (job->color && match_len > 0 && !job->invert) {
+        ob_append(ob, line, col);
+        ob_puts(ob, COLOR_MATCH);
+        ob_append(ob, line + col, match_len);
+        ob_puts(ob, COLOR_RESET);
+        ob_append(ob, line + col + match_len, line_len - col - match_len);
+    } else {
+        ob_append(ob, line, line_len);
+    }
+    ob_append(ob, "\n", 1);
+}
+
+// Does this line match? On success reports the match column and length.
+static int line_matches(SearchJob *job, const char *line, size_t len, size_t *col, size_t *mlen) {
+    if (job->literal) {
+        const char *hit = find_with_offsets(line, len, job->literal, job->lit_len,
+                                            job->rare1, job->rare2, job->ignore_case);
+        if (!hit) return 0;
+        if (!job->use_regex) {
+            *col = (size_t)(hit - line);
+            *mlen = job->lit_len;
+            return 1;
+        }
+    }
+    regmatch_t m;
+    m.rm_so = 0;
+    m.rm_eo = (regoff_t)len;
+    if (regexec(&job->regex, line, 1, &m, REG_STARTEND) != 0) return 0;
+    *col = (size_t)m.rm_so;
+    *mlen = (size_t)(m.rm_eo - m.rm_so);
+    return 1;
+}
+
+// Scan a buffer of whole lines; the last line may lack its newline
+static void scan_buffer(SearchJob *job, FileScan *fs, const char *buf, size_t len, int ordered) {
+    const char *end = buf + len;
+    const char *pos = buf;
+    const char *counted = buf;
+    size_t line_base = fs->lines_before;
+    int need_numbers = job->line_numbers || job->table;
+
+    while (pos < end && !fs->done) {
+        const char *line_start;
+        const char *line_end;
+        size_t col = 0, mlen = 0;
+
+        if (job->literal && !job->invert) {
+            // Jump straight to the next candidate instead of walking lines
+            const char *hit = find_with_offsets(pos, (size_t)(end - pos), job->literal, job->lit_len,
+                                                job->rare1, job->rare2, job->ignore_case);
+            if (!hit) break;
+            line_start = memrchr(pos, '\n', (size_t)(hit - pos));
+            line_start = line_start ? line_start + 1 : pos;
+            line_end = memchr(hit, '\n', (size_t)(end - hit));
+            if (!line_end) line_end = end;
+            if (job->use_regex) {
+                if (!line_matches(job, line_start, (size_t)(line_end - line_start), &col, &mlen)) {
+                    pos = line_end + 1;
+                    continue;
+                }
+            } else {
+                col = (size_t)(hit - line_start);
+                mlen = job->lit_len;
+            }
+        } else {
+            line_start = pos;
+            line_end = memchr(pos, '\n', (size_t)(end - pos));
+            if (!line_end) line_end = end;
+            int hit = line_matches(job, line_start, (size_t)(line_end - line_start), &col, &mlen);
+            if (hit == job->invert) {
+                pos = line_end + 1;
+                continue;
+            }
+            if (job->invert) mlen = 0;
+        }
+
+        size_t line_no = 0;
+        if (need_numbers) {
+            line_base += count_newlines(counted, line_start);
+            counted = line_start;
+            line_no = line_base + 1;
+        }
+        emit_match(job, fs, line_no, line_start, (size_t)(line_end - line_start), col, mlen);
+        maybe_flush(job, fs, ordered);
+        pos = line_end + 1;
+    }
+
+    if (need_numbers) {
+        fs->lines_before = line_base + count_newlines(counted, end);
+    }
+}
+
+static void finish_file_output(SearchJob *job, FileScan *fs) {
+    if (job->files_only) {
+        if (fs->matches > 0) {
+            ob_puts(&fs->out, fs->name);
+            ob_append(&fs->out, "\n", 1);
+        }
+    } else if (job->count_only) {
+        if (job->show_names) {
+            ob_puts(&fs->out, fs->name);
+            ob_append(&fs->out, ":", 1);
+        }
+        ob_number(&fs->out, fs->matches);
+        ob_append(&fs->out, "\n", 1);
+    } else if (fs->binary && fs->matches > 0) {
+        ob_puts(&fs->out, "Binary file ");
+        ob_puts(&fs->out, fs->name);
+        ob_puts(&fs->out, " matches\n");
+    }
+}
+
+static void search_mapped(SearchJob *job, FileScan *fs, const char *data, size_t len, int ordered) {
+    fs->binary = memchr(data, '\0', len < BINARY_PROBE ? len : BINARY_PROBE) != NULL;
+    scan_buffer(job, fs, data, len, ordered);
+}
+
+// Streaming search for pipes, procfs and small files: whole lines per chunk
+static int search_stream(SearchJob *job, FileScan *fs, int fd, int ordered) {
+    size_t cap = READ_CHUNK;
+    char *buf = malloc(cap);
+    if (!buf) return -1;
+    size_t have = 0;
+    int first = 1;
+
+    for (;;) {
+        if (have == cap) {
+            char *grown = realloc(buf, cap * 2);
+            if (!grown) break;
+            buf = grown;
+            cap *= 2;
+        }
+        ssize_t n = read(fd, buf + have, cap - have);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            free(buf);
+            return -1;
+        }
+        if (n == 0) break;
+        if (first) {
+            fs->binary = memchr(buf + have, '\0', (size_t)n < BINARY_PROBE ? (size_t)n : BINARY_PROBE) != NULL;
+            first = 0;
+        }
+        have += (size_t)n;
+
+        const char *last_nl = memrchr(buf, '\n', have);
+        if (!last_nl) continue;
+        size_t whole = (size_t)(last_nl - buf) + 1;
+        scan_buffer(job, fs, buf, whole, ordered);
+        if (fs->streaming && fs->out.len > 0) {
+            write_out(fs->out.data, fs->out.len);
+            fs->out.len = 0;
+        }
+        memmove(buf, buf + whole, have - whole);
+        have -= whole;
+        if (fs->done) break;
+    }
+    if (have > 0 && !fs->done) {
+        scan_buffer(job, fs, buf, have, ordered);
+    }
+    free(buf);
+    return 0;
+}
+
+static void search_file(SearchJob *job, const char *path, int slot) {
+    FileScan fs;
+    memset(&fs, 0, sizeof(fs));
+    fs.name = path;
+    int ordered = slot >= 0;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "searchtext: %s: %s\n", path, strerror(errno));
+        if (fd >= 0) close(fd);
+    } else if (S_ISDIR(st.st_mode)) {
+        fprintf(stderr, "searchtext: %s: Is a directory\n", path);
+        close(fd);
+    } else {
+        if (S_ISREG(st.st_mode) && st.st_size >= MMAP_THRESHOLD) {
+            void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED) {
+                madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+                search_mapped(job, &fs, map, (size_t)st.st_size, ordered);
+                munmap(map, (size_t)st.st_size);
+            } else {
+                search_stream(job, &fs, fd, ordered);
+            }
+        } else {
+            search_stream(job, &fs, fd, ordered);
+        }
+        close(fd);
+        finish_file_output(job, &fs);
+    }
+
+    if (!ordered) {
+        if (!fs.holding_output) pthread_mutex_lock(&job->out_lock);
+        write_out(fs.out.data, fs.out.len);
+        pthread_mutex_unlock(&job->out_lock);
+        free(fs.out.data);
+        return;
+    }
+
+    // Park the result and release every consecutive finished slot
+    OutBuf *result = malloc(sizeof(OutBuf));
+    if (result) *result = fs.out;
+    pthread_mutex_lock(&job->out_lock);
+    job->slots[slot] = result;
+    job->slot_done[slot] = 1;
+    while (job->next_slot < job->slot_count && job->slot_done[job->next_slot]) {
+        OutBuf *ob = job->slots[job->next_slot];
+        if (ob) {
+            write_out(ob->data, ob->len);
+            free(ob->data);
+            free(ob);
+        }
+        job->slots[job->next_slot] = NULL;
+        job->next_slot++;
+    }
+    pthread_mutex_unlock(&job->out_lock);
+    if (!result) free(fs.out.data);
+}
+
+// ---------------------------------------------------------------------------
+// .gitignore handling
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    char *pattern;
+    int negate;
+    int dir_only;
+    int anchored;
+} IgnoreRule;
+
+typedef struct IgnoreList {
+    struct IgnoreList *parent;
+    atomic_int refs;
+    char *base;              // directory holding the .gitignore, relative to the search root
+    IgnoreRule *rules;
+    int count;
+} IgnoreList;
+
+static IgnoreList* ignore_retain(IgnoreList *list) {
+    if (list) atomic_fetch_add(&list->refs, 1);
+    return list;
+}
+
+static void ignore_release(IgnoreList *list) {
+    while (list && atomic_fetch_sub(&list->refs, 1) == 1) {
+        IgnoreList *parent = list->parent;
+        for (int i = 0; i < list->count; i++) free(list->rules[i].pattern);
+        free(list->rules);
+        free(list->base);
+        free(list);
+        list = parent;
+    }
+}
+
+static IgnoreList* ignore_load(const char *path, const char *base, IgnoreList *parent) {
+    FILE *f = fopen(path, "r");
+    if (!f) return ignore_retain(parent);
+
+    IgnoreList *list = calloc(1, sizeof(IgnoreList));
+    if (!list) {
+        fclose(f);
+        return ignore_retain(parent);
+    }
+    atomic_init(&list->refs, 1);
+    list->parent = ignore_retain(parent);
+    list->base = strdup(base);
+
+    char line[PATH_MAX];
+    int cap = 0;
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char *p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '\0' || *p == '#') continue;
+
+        IgnoreRule rule;
+        memset(&rule, 0, sizeof(rule));
+        if (*p == '!') {
+            rule.negate = 1;
+            p++;
+        }
+        size_t len = strlen(p);
+        while (len > 0 && (p[len - 1] == ' ' || p[len - 1] == '\t')) p[--len] = '\0';
+        if (len > 0 && p[len - 1] == '/') {
+            rule.dir_only = 1;
+            p[--len] = '\0';
+        }
+        if (*p == '/') {
+            rule.anchored = 1;
+            p++;
+        } else if (strchr(p, '/')) {
+            rule.anchored = 1;
+        }
+        if (*p == '\0') continue;
+
+        if (list->count == cap) {
+            cap = cap ? cap * 2 : 16;
+            IgnoreRule *grown = realloc(list->rules, (size_t)cap * sizeof(IgnoreRule));
+            if (!grown) break;
+            list->rules = grown;
+        }
+        rule.pattern = strdup(p);
+        list->rules[list->count++] = rule;
+    }
+    fclose(f);
+    return list;
+}
+
+// relpath is relative to the search root; innermost .gitignore decides first
+static int is_ignored(const IgnoreList *list, const char *relpath, const char *name, int is_dir) {
+    for (; list; list = list->parent) {
+        const char *rel = relpath;
+        size_t blen = strlen(list->base);
+        if (blen > 0) {
+            if (strncmp(relpath, list->base, blen) != 0 || relpath[blen] != '/') continue;
+            rel = relpath + blen + 1;
+        }
+        int verdict = -1;
+        for (int i = 0; i < list->count; i++) {
+            const IgnoreRule *r = &list->rules[i];
+            if (r->dir_only && !is_dir) continue;
+            int hit = r->anchored ? fnmatch(r->pattern, rel, FNM_PATHNAME) == 0
+                                  : fnmatch(r->pattern, name, 0) == 0;
+            if (hit) verdict = !r->negate;
+        }
+        if (verdict >= 0) return verdict;
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Recursive walk
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    SearchJob *job;
+    char *path;
+    size_t root_len;         // length of the operand this walk started from
+    IgnoreList *ignore;
+} DirTask;
+
+typedef struct {
+    SearchJob *job;
+    char *path;
+} FileTask;
+
+static void file_task(void *arg) {
+    FileTask *t = arg;
+    search_file(t->job, t->path, -1);
+    free(t->path);
+    free(t);
+}
+
+static const char* relative_to_root(const char *path, size_t root_len) {
+    const char *rel = path + root_len;
+    while (*rel == '/') rel++;
+    return rel;
+}
+
+static void dir_task(void *arg) {
+    DirTask *t = arg;
+    SearchJob *job = t->job;
+
+    DIR *dir = opendir(t->path);
+    if (!dir) {
+        fprintf(stderr, "searchtext: %s: %s\n", t->path, strerror(errno));
+        ignore_release(t->ignore);
+        free(t->path);
+        free(t);
+        return;
+    }
+
+    // Collect the entries first so a .gitignore found anywhere in the
+    // directory applies to all of its siblings, without a second readdir pass
+    size_t count = 0, cap = 64;
+    char **names = malloc(cap * sizeof(char *));
+    unsigned char *types = malloc(cap);
+    int has_gitignore = 0;
+    struct dirent *entry;
+    while (names && types && (entry = readdir(dir)) != NULL) {
+        const char *n = entry->d_name;
+        if (n[0] == '.' && (n[1] == '\0' || (n[1] == '.' && n[2] == '\0'))) continue;
+        if (strcmp(n, ".git") == 0) continue;
+        if (strcmp(n, ".gitignore") == 0) has_gitignore = 1;
+        if (count == cap) {
+            cap *= 2;
+            char **gn = realloc(names, cap * sizeof(char *));
+            unsigned char *gt = realloc(types, cap);
+            if (gn) names = gn;
+            if (gt) types = gt;
+            if (!gn || !gt) break;
+        }
+        names[count] = strdup(n);
+        types[count] = entry->d_type;
+        count++;
+    }
+    closedir(dir);
+
+    IgnoreList *ignore = t->ignore;
+    if (has_gitignore) {
+        char gi_path[PATH_MAX];
+        snprintf(gi_path, sizeof(gi_path), "%s/.gitignore", t->path);
+        ignore = ignore_load(gi_path, relative_to_root(t->path, t->root_len), t->ignore);
+        ignore_release(t->ignore);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        char child[PATH_MAX];
+        snprintf(child, sizeof(child), "%s/%s", t->path, names[i]);
+        unsigned char type = types[i];
+        if (type == DT_UNKNOWN) {
+            struct stat st;
+            if (lstat(child, &st) == 0) type = IFTODT(st.st_mode);
+        }
+        free(names[i]);
+
+        // Symlinks are not followed during recursion, matching grep -r
+        if (type != DT_DIR && type != DT_REG) continue;
+        const char *rel = relative_to_root(child, t->root_len);
+        const char *base = strrchr(child, '/') + 1;
+        if (is_ignored(ignore, rel, base, type == DT_DIR)) continue;
+
+        if (type == DT_DIR) {
+            DirTask *sub = malloc(sizeof(DirTask));
+            if (!sub) continue;
+            sub->job = job;
+            sub->path = strdup(child);
+            sub->root_len = t->root_len;
+            sub->ignore = ignore_retain(ignore);
+            thread_pool_submit(job->pool, dir_task, sub);
+        } else {
+            FileTask *ft = malloc(sizeof(FileTask));
+            if (!ft) continue;
+            ft->job = job;
+            ft->path = strdup(child);
+            thread_pool_submit(job->pool, file_task, ft);
+        }
+    }
+    free(names);
+    free(types);
+    ignore_release(ignore);
+    free(t->path);
+    free(t);
+}
+
+typedef struct {
+    SearchJob *job;
+    char *path;
+    int slot;
+} OperandTask;
+
+static void operand_task(void *arg) {
+    OperandTask *t = arg;
+    search_file(t->job, t->path, t->slot);
+    free(t);
+}
+
+// ---------------------------------------------------------------------------
+// Pattern compilation and the command itself
+// ---------------------------------------------------------------------------
+
+static int is_regex_meta(char c) {
+    return c != '\0' && strchr(".[]()*+?{}|^$\\", c) != NULL;
+}
+
+// Longest run of plain characters every match must contain, or NULL.
+// Alternation and groups make runs optional, so those bail out or reset.
+static char* required_literal(const char *re) {
+    if (strchr(re, '|')) return NULL;
+    const char *best = NULL;
+    size_t best_len = 0;
+    const char *run = NULL;
+    size_t run_len = 0;
+
+    for (const char *p = re; *p; p++) {
+        char c = *p;
+        if (c == '[') {
+            while (*p && *p != ']') p++;
+            if (!*p) break;
+            run_len = 0;
+            continue;
+        }
+        if (c == '(') {
+            int depth = 1;
+            while (p[1] && depth > 0) {
+                p++;
+                if (*p == '(') depth++;
+                else if (*p == ')') depth--;
+            }
+            run_len = 0;
+            continue;
+        }
+        if (c == '*' || c == '?' || c == '{') {
+            // The preceding character was optional: drop it from the run
+            if (run_len > 0) run_len--;
+            if (run_len > best_len) {
+                best = run;
+                best_len = run_len;
+            }
+            run_len = 0;
+            continue;
+        }
+        if (is_regex_meta(c)) {
+            if (run_len > best_len) {
+                best = run;
+                best_len = run_len;
+            }
+            run_len = 0;
+            if (c == '\\' && p[1]) p++;
+            continue;
+        }
+        if (run_len == 0) run = p;
+        run_len++;
+        if (run_len > best_len && !(p[1] == '*' || p[1] == '?' || p[1] == '{')) {
+            best = run;
+            best_len = run_len;
+        }
+    }
+    if (best_len < 2) return NULL;
+    return strndup(best, best_len);
+}
+
+static int run_external_grep(char **args) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        execvp("grep", args);
+        perror("searchtext");
+        exit(EXIT_FAILURE);
+    } else if (pid > 0) {
+        waitpid(pid, NULL, 0);
+    } else {
+        perror("fork");
+    }
+    return 1;
+}
+
+int razz_searchtext(char **args) {
+    SearchJob job;
+    memset(&job, 0, sizeof(job));
+    int fixed = 0;
+    int argi = 1;
+
+    for (; args[argi] && args[argi][0] == '-' && args[argi][1] != '\0'; argi++) {
+        const char *opt = args[argi];
+        if (strcmp(opt, "--") == 0) {
+            argi++;
+            break;
+        }
+        if (strcmp(opt, "--table") == 0) {
+            job.table = 1;
+            continue;
+        }
+        if (opt[1] == '-') return run_external_grep(args);
+        for (const char *c = opt + 1; *c; c++) {
+            switch (*c) {
+                case 'i': job.ignore_case = 1; break;
+                case 'n': job.line_numbers = 1; break;
+                case 'r': case 'R': job.recursive = 1; break;
+                case 'F': fixed = 1; break;
+                case 'E': break;
+                case 'v': job.invert = 1; break;
+                case 'l': job.files_only = 1; break;
+                case 'c': job.count_only = 1; break;
+                default:
+                    // Anything else keeps full grep semantics
+                    return run_external_grep(args);
+            }
+        }
+    }
+
+    const char *pattern = args[argi];
+    if (!pattern) {
+        fprintf(stderr, "Usage: searchtext [-inrFvlc] [--table] [pattern] [file...]\n");
+        return 1;
+    }
+    char **operands = &args[argi + 1];
+    int operand_count = 0;
+    while (operands[operand_count]) operand_count++;
+
+    if (fixed || !strpbrk(pattern, ".[]()*+?{}|^$\\")) {
+        job.literal = strdup(pattern);
+        job.lit_len = strlen(pattern);
+    } else {
+        int flags = REG_EXTENDED | REG_NEWLINE;
+        if (job.ignore_case) flags |= REG_ICASE;
+        int rc = regcomp(&job.regex, pattern, flags);
+        if (rc != 0) {
+            char err[256];
+            regerror(rc, &job.regex, err, sizeof(err));
+            fprintf(stderr, "searchtext: invalid pattern: %s\n", err);
+            return 1;
+        }
+        job.use_regex = 1;
+        job.literal = required_literal(pattern);
+        job.lit_len = job.literal ? strlen(job.literal) : 0;
+    }
+    if (job.literal && job.lit_len == 0) {
+        free(job.literal);
+        job.literal = NULL;
+    }
+    if (job.literal) pick_rare_offsets(job.literal, job.lit_len, &job.rare1, &job.rare2);
+
+    job.color = isatty(STDOUT_FILENO) && !job.table;
+    job.show_names = job.recursive || operand_count > 1;
+    pthread_mutex_init(&job.out_lock, NULL);
+    fflush(stdout);
+
+    if (job.table) {
+        const char *header = "FILE LINE COL TEXT\n";
+        write_out(header, strlen(header));
+    }
+
+    if (operand_count == 0 && !job.recursive) {
+        // Pipeline stage: stream stdin
+        FileScan fs;
+        memset(&fs, 0, sizeof(fs));
+        fs.name = "(standard input)";
+        fs.streaming = 1;
+        search_stream(&job, &fs, STDIN_FILENO, 1);
+        finish_file_output(&job, &fs);
+        write_out(fs.out.data, fs.out.len);
+        free(fs.out.data);
+    } else {
+        job.pool = thread_pool_create(0, MAX_PENDING_TASKS);
+        static char *dot[] = { ".", NULL };
+        if (operand_count == 0) {
+            operands = dot;
+            operand_count = 1;
+        }
+        job.slot_count = operand_count;
+        job.slots = calloc((size_t)operand_count, sizeof(OutBuf *));
+        job.slot_done = calloc((size_t)operand_count, sizeof(int));
+
+        for (int i = 0; i < operand_count; i++) {
+            struct stat st;
+            if (job.recursive && stat(operands[i], &st) == 0 && S_ISDIR(st.st_mode)) {
+                // Directory output is unordered; mark the slot so later operands are not held back
+                pthread_mutex_lock(&job.out_lock);
+                job.slot_done[i] = 1;
+                pthread_mutex_unlock(&job.out_lock);
+                DirTask *dt = malloc(sizeof(DirTask));
+                if (!dt) continue;
+                dt->job = &job;
+                dt->path = strdup(operands[i]);
+                dt->root_len = strlen(operands[i]);
+                dt->ignore = NULL;
+                if (job.pool) thread_pool_submit(job.pool, dir_task, dt);
+                else dir_task(dt);
+                continue;
+            }
+            OperandTask *ot = malloc(sizeof(OperandTask));
+            if (!ot) continue;
+            ot->job = &job;
+            ot->path = operands[i];
+            ot->slot = i;
+            if (job.pool) thread_pool_submit(job.pool, operand_task, ot);
+            else operand_task(ot);
+        }
+        if (job.pool) thread_pool_destroy(job.pool);
+
+        // Flush anything still parked behind a directory operand
+        for (; job.next_slot < job.slot_count; job.next_slot++) {
+            OutBuf *ob = job.slots[job.next_slot];
+            if (ob) {
+                write_out(ob->data, ob->len);
+                free(ob->data);
+                free(ob);
+            }
+        }
+        free(job.slots);
+        free(job.slot_done);
+    }
+
+    pthread_mutex_destroy(&job.out_lock);
+    if (job.use_regex) regfree(&job.regex);
+    free(job.literal);
+    return 1;
+}
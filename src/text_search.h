@@ -0,0 +1,19 @@
+#ifndef TEXT_SEARCH_H
+#define TEXT_SEARCH_H
+
+#include <stddef.h>
+
+// Command: searchtext (grep)
+// searchtext [-i] [-n] [-r] [-F] [-v] [-l] [-c] [--table] PATTERN [PATH...]
+// Literal patterns use a SIMD prefilter; everything else goes through POSIX
+// extended regexes. Recursive searches run on a work-stealing pool and
+// honour .gitignore files. --table emits FILE LINE COL TEXT rows for the
+// object pipeline.
+int razz_searchtext(char **args);
+
+// Find needle in haystack using the rare-byte SIMD prefilter.
+// Returns a pointer to the first match or NULL.
+const char* text_search_find(const char *hay, size_t hay_len,
+                             const char *needle, size_t needle_len, int ignore_case);
+
+#endif // TEXT_SEARCH_H
@@ -0,0 +1,255 @@
+#include "thread_pool.h"
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+typedef struct {
+    ThreadTaskFn fn;
+    void *arg;
+} PoolTask;
+
+// Bounded double-ended queue. The owning worker pushes and pops at the
+// tail (LIFO keeps its working set hot); idle workers steal from the head.
+typedef struct {
+    PoolTask *tasks;
+    int capacity;
+    int head;
+    int count;
+    pthread_mutex_t lock;
+} WorkDeque;
+
+struct ThreadPool {
+    pthread_t *threads;
+    int nthreads;
+    int started;
+
+    // One deque per worker plus a shared injection deque at index nthreads
+    // for tasks submitted from outside the pool
+    WorkDeque *deques;
+    int ndeques;
+    atomic_int queued;
+
+    int active;          // queued + running tasks
+    int shutting_down;
+
+    pthread_mutex_t idle_lock;
+    pthread_cond_t has_work;
+    pthread_cond_t all_done;
+};
+
+typedef struct {
+    ThreadPool *pool;
+    int index;
+} WorkerArg;
+
+// Which pool/deque the current thread works for (-1 outside any pool)
+static __thread ThreadPool *current_pool = NULL;
+static __thread int current_index = -1;
+
+int thread_pool_default_size(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+static int deque_push(WorkDeque *dq, ThreadTaskFn fn, void *arg) {
+    pthread_mutex_lock(&dq->lock);
+    if (dq->count >= dq->capacity) {
+        pthread_mutex_unlock(&dq->lock);
+        return 0;
+    }
+    int tail = (dq->head + dq->count) % dq->capacity;
+    dq->tasks[tail].fn = fn;
+    dq->tasks[tail].arg = arg;
+    dq->count++;
+    pthread_mutex_unlock(&dq->lock);
+    return 1;
+}
+
+static int deque_pop_tail(WorkDeque *dq, PoolTask *out) {
+    pthread_mutex_lock(&dq->lock);
+    if (dq->count == 0) {
+        pthread_mutex_unlock(&dq->lock);
+        return 0;
+    }
+    dq->count--;
+    *out = dq->tasks[(dq->head + dq->count) % dq->capacity];
+    pthread_mutex_unlock(&dq->lock);
+    return 1;
+}
+
+static int deque_pop_head(WorkDeque *dq, PoolTask *out) {
+    pthread_mutex_lock(&dq->lock);
+    if (dq->count == 0) {
+        pthread_mutex_unlock(&dq->lock);
+        return 0;
+    }
+    *out = dq->tasks[dq->head];
+    dq->head = (dq->head + 1) % dq->capacity;
+    dq->count--;
+    pthread_mutex_unlock(&dq->lock);
+    return 1;
+}
+
+// Own deque first, then the injection queue, then steal from siblings
+static int find_task(ThreadPool *pool, int self, PoolTask *out) {
+    if (deque_pop_tail(&pool->deques[self], out)) return 1;
+    if (deque_pop_head(&pool->deques[pool->nthreads], out)) return 1;
+    for (int i = 1; i < pool->nthreads; i++) {
+        int victim = (self + i) % pool->nthreads;
+        if (deque_pop_head(&pool->deques[victim], out)) return 1;
+    }
+    return 0;
+}
+
+static void task_finished(ThreadPool *pool) {
+    pthread_mutex_lock(&pool->idle_lock);
+    pool->active--;
+    if (pool->active == 0) {
+        pthread_cond_broadcast(&pool->all_done);
+    }
+    pthread_mutex_unlock(&pool->idle_lock);
+}
+
+static void* worker_main(void *arg) {
+    WorkerArg *wa = arg;
+    ThreadPool *pool = wa->pool;
+    int self = wa->index;
+    free(wa);
+
+    current_pool = pool;
+    current_index = self;
+
+    for (;;) {
+        PoolTask task;
+        if (find_task(pool, self, &task)) {
+            atomic_fetch_sub(&pool->queued, 1);
+            task.fn(task.arg);
+            task_finished(pool);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->idle_lock);
+        while (atomic_load(&pool->queued) == 0 && !pool->shutting_down) {
+            pthread_cond_wait(&pool->has_work, &pool->idle_lock);
+        }
+        int done = pool->shutting_down && atomic_load(&pool->queued) == 0;
+        pthread_mutex_unlock(&pool->idle_lock);
+        if (done) break;
+    }
+    return NULL;
+}
+
+ThreadPool* thread_pool_create(int nthreads, int max_pending) {
+    if (nthreads <= 0) nthreads = thread_pool_default_size();
+    if (max_pending <= 0) max_pending = 1024;
+
+    ThreadPool *pool = calloc(1, sizeof(ThreadPool));
+    if (!pool) return NULL;
+
+    pool->threads = calloc(nthreads, sizeof(pthread_t));
+    pool->deques = calloc(nthreads + 1, sizeof(WorkDeque));
+    if (!pool->threads || !pool->deques) {
+        free(pool->threads);
+        free(pool->deques);
+        free(pool);
+        return NULL;
+    }
+
+    // Split the pending budget across the deques so the total stays bounded
+    int per_deque = max_pending / (nthreads + 1);
+    if (per_deque < 4) per_deque = 4;
+    pool->ndeques = nthreads + 1;
+    for (int i = 0; i < pool->ndeques; i++) {
+        pool->deques[i].tasks = calloc(per_deque, sizeof(PoolTask));
+        pool->deques[i].capacity = pool->deques[i].tasks ? per_deque : 0;
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+    }
+    atomic_init(&pool->queued, 0);
+    pthread_mutex_init(&pool->idle_lock, NULL);
+    pthread_cond_init(&pool->has_work, NULL);
+    pthread_cond_init(&pool->all_done, NULL);
+
+    // Workers read nthreads while looking for victims, so fix it before starting any
+    pool->nthreads = nthreads;
+    for (int i = 0; i < nthreads; i++) {
+        WorkerArg *wa = malloc(sizeof(WorkerArg));
+        if (wa) {
+            wa->pool = pool;
+            wa->index = i;
+        }
+        if (!wa || pthread_create(&pool->threads[i], NULL, worker_main, wa) != 0) {
+            free(wa);
+            thread_pool_destroy(pool);
+            return NULL;
+        }
+        pool->started++;
+    }
+    return pool;
+}
+
+// Queue a task. When the target deque is full the task either runs in the
+// caller (run_if_full) or is dropped and 0 is returned.
+static int submit_task(ThreadPool *pool, ThreadTaskFn fn, void *arg, int run_if_full) {
+    int target = (current_pool == pool) ? current_index : pool->nthreads;
+
+    // Count the task before it becomes visible so thread_pool_wait never
+    // observes zero while it is in flight
+    pthread_mutex_lock(&pool->idle_lock);
+    pool->active++;
+    pthread_mutex_unlock(&pool->idle_lock);
+
+    atomic_fetch_add(&pool->queued, 1);
+    if (pool->nthreads == 0 || !deque_push(&pool->deques[target], fn, arg)) {
+        // Deque full: run in the caller so memory stays bounded
+        atomic_fetch_sub(&pool->queued, 1);
+        if (run_if_full) fn(arg);
+        task_finished(pool);
+        return run_if_full;
+    }
+
+    pthread_mutex_lock(&pool->idle_lock);
+    pthread_cond_signal(&pool->has_work);
+    pthread_mutex_unlock(&pool->idle_lock);
+    return 1;
+}
+
+void thread_pool_submit(ThreadPool *pool, ThreadTaskFn fn, void *arg) {
+    submit_task(pool, fn, arg, 1);
+}
+
+int thread_pool_try_submit(ThreadPool *pool, ThreadTaskFn fn, void *arg) {
+    return submit_task(pool, fn, arg, 0);
+}
+
+void thread_pool_wait(ThreadPool *pool) {
+    pthread_mutex_lock(&pool->idle_lock);
+    while (pool->active > 0) {
+        pthread_cond_wait(&pool->all_done, &pool->idle_lock);
+    }
+    pthread_mutex_unlock(&pool->idle_lock);
+}
+
+void thread_pool_destroy(ThreadPool *pool) {
+    if (!pool) return;
+    thread_pool_wait(pool);
+
+    pthread_mutex_lock(&pool->idle_lock);
+    pool->shutting_down = 1;
+    pthread_cond_broadcast(&pool->has_work);
+    pthread_mutex_unlock(&pool->idle_lock);
+
+    for (int i = 0; i < pool->started; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    for (int i = 0; i < pool->ndeques; i++) {
+        free(pool->deques[i].tasks);
+        pthread_mutex_destroy(&pool->deques[i].lock);
+    }
+    pthread_mutex_destroy(&pool->idle_lock);
+    pthread_cond_destroy(&pool->has_work);
+    pthread_cond_destroy(&pool->all_done);
+    free(pool->threads);
+    free(pool->deques);
+    free(pool);
+}
@@ -0,0 +1,30 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+// Task callback executed by a pool worker
+typedef void (*ThreadTaskFn)(void *arg);
+
+typedef struct ThreadPool ThreadPool;
+
+// Create a pool with nthreads workers (<= 0 picks the CPU count).
+// max_pending bounds the queue; once it is full, submit runs the task
+// in the calling thread instead of growing memory.
+ThreadPool* thread_pool_create(int nthreads, int max_pending);
+
+// Queue a task (or run it inline when the queue is full)
+void thread_pool_submit(ThreadPool *pool, ThreadTaskFn fn, void *arg);
+
+// Queue a task but never run it in the caller: returns 0 when the queue is
+// full. For callers that must not block on the task (e.g. slow filesystems).
+int thread_pool_try_submit(ThreadPool *pool, ThreadTaskFn fn, void *arg);
+
+// Block until every submitted task, including ones submitted by tasks, has finished
+void thread_pool_wait(ThreadPool *pool);
+
+// Stop workers and free the pool (waits for outstanding tasks first)
+void thread_pool_destroy(ThreadPool *pool);
+
+// Number of online CPUs (at least 1)
+int thread_pool_default_size(void);
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,489 @@
+#define _GNU_SOURCE
+#include "tree_copy.h"
+#include "thread_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/syscall.h>
+
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
+#define GETDENTS_BUF_SIZE (64 * 1024)
+#define COPY_BUF_SIZE     (256 * 1024)
+#define FILE_BATCH        64
+// Pending tasks may each hold two directory fds, so keep this well below RLIMIT_NOFILE
+#define MAX_PENDING_TASKS 128
+
+// Record layout returned by getdents64(2)
+struct linux_dirent64 {
+    ino_t d_ino;
+    off_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+// Directory metadata applied after the whole tree has been copied
+typedef struct {
+    char *relpath;
+    int depth;
+    mode_t mode;
+    uid_t uid;
+    gid_t gid;
+    struct timespec times[2];
+} DirMeta;
+
+typedef struct {
+    int src_root;
+    int dst_root;
+    int preserve_owner;
+    ThreadPool *pool;
+
+    pthread_mutex_t lock;
+    DirMeta *dirs;
+    size_t dir_count;
+    size_t dir_cap;
+
+    atomic_int errors;
+} CopyJob;
+
+// Directory fds shared by the walker and the file batches created from it
+typedef struct {
+    int src_fd;
+    int dst_fd;
+    atomic_int refs;
+} DirHandle;
+
+typedef struct {
+    CopyJob *job;
+    char *relpath;
+    int depth;
+} DirTask;
+
+typedef struct {
+    CopyJob *job;
+    DirHandle *dir;
+    char *relpath;
+    int count;
+    char *names[FILE_BATCH];
+} FileBatch;
+
+static void report_error(CopyJob *job, const char *relpath, const char *name, int err) {
+    pthread_mutex_lock(&job->lock);
+    if (name) {
+        fprintf(stderr, "copy: %s/%s: %s\n", relpath, name, strerror(err));
+    } else {
+        fprintf(stderr, "copy: %s: %s\n", relpath, strerror(err));
+    }
+    pthread_mutex_unlock(&job->lock);
+    atomic_fetch_add(&job->errors, 1);
+}
+
+static void dir_handle_release(DirHandle *h) {
+    if (atomic_fetch_sub(&h->refs, 1) == 1) {
+        close(h->src_fd);
+        close(h->dst_fd);
+        free(h);
+    }
+}
+
+static char* join_relpath(const char *parent, const char *name) {
+    if (strcmp(parent, ".") == 0) return strdup(name);
+    size_t plen = strlen(parent);
+    size_t nlen = strlen(name);
+    char *out = malloc(plen + nlen + 2);
+    if (!out) return NULL;
+    memcpy(out, parent, plen);
+    out[plen] = '/';
+    memcpy(out + plen + 1, name, nlen + 1);
+    return out;
+}
+
+static void record_dir(CopyJob *job, char *relpath, int depth, const struct stat *st) {
+    pthread_mutex_lock(&job->lock);
+    if (job->dir_count == job->dir_cap) {
+        size_t cap = job->dir_cap ? job->dir_cap * 2 : 256;
+        DirMeta *grown = realloc(job->dirs, cap * sizeof(DirMeta));
+        if (!grown) {
+            pthread_mutex_unlock(&job->lock);
+            return;
+        }
+        job->dirs = grown;
+        job->dir_cap = cap;
+    }
+    DirMeta *m = &job->dirs[job->dir_count++];
+    m->relpath = strdup(relpath);
+    m->depth = depth;
+    m->mode = st->st_mode;
+    m->uid = st->st_uid;
+    m->gid = st->st_gid;
+    m->times[0] = st->st_atim;
+    m->times[1] = st->st_mtim;
+    pthread_mutex_unlock(&job->lock);
+}
+
+// Copy file contents, preferring in-kernel copy_file_range (reflinks on btrfs/xfs)
+static int copy_data(int in, int out, off_t size) {
+    off_t left = size;
+    while (left > 0) {
+        ssize_t n = copy_file_range(in, NULL, out, NULL, (size_t)left, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP) break;
+            return -1;
+        }
+        if (n == 0) return 0; // file shrank underneath us
+        left -= n;
+    }
+    if (left == 0) return 0;
+
+    // Fallback for filesystems without copy_file_range support
+    char *buf = malloc(COPY_BUF_SIZE);
+    if (!buf) return -1;
+    ssize_t n;
+    while ((n = read(in, buf, COPY_BUF_SIZE)) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            free(buf);
+            return -1;
+        }
+        ssize_t done = 0;
+        while (done < n) {
+            ssize_t w = write(out, buf + done, n - done);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                free(buf);
+                return -1;
+            }
+            done += w;
+        }
+    }
+    free(buf);
+    return 0;
+}
+
+// Copy a single non-directory entry from (sfd, name) to (dfd, name)
+static int copy_entry_at(int sfd, const char *sname, int dfd, const char *dname, int preserve_owner) {
+    struct stat st;
+    if (fstatat(sfd, sname, &st, AT_SYMLINK_NOFOLLOW) != 0) return -1;
+    struct timespec times[2] = { st.st_atim, st.st_mtim };
+
+    if (S_ISREG(st.st_mode)) {
+        int in = openat(sfd, sname, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+        if (in < 0) return -1;
+        posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+        int out = openat(dfd, dname, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        if (out < 0) {
+            close(in);
+            return -1;
+        }
+        int rc = copy_data(in, out, st.st_size);
+        int saved = errno;
+        if (rc == 0) {
+            if (preserve_owner) fchown(out, st.st_uid, st.st_gid);
+            fchmod(out, st.st_mode & 07777);
+            futimens(out, times);
+        }
+        close(in);
+        close(out);
+        errno = saved;
+        return rc;
+    }
+
+    if (S_ISLNK(st.st_mode)) {
+        char target[PATH_MAX];
+        ssize_t len = readlinkat(sfd, sname, target, sizeof(target) - 1);
+        if (len < 0) return -1;
+        target[len] = '\0';
+        if (symlinkat(target, dfd, dname) != 0) return -1;
+        if (preserve_owner) fchownat(dfd, dname, st.st_uid, st.st_gid, AT_SYMLINK_NOFOLLOW);
+        utimensat(dfd, dname, times, AT_SYMLINK_NOFOLLOW);
+        return 0;
+    }
+
+    // FIFOs, sockets and device nodes
+    if (mknodat(dfd, dname, st.st_mode, st.st_rdev) != 0) return -1;
+    if (preserve_owner) fchownat(dfd, dname, st.st_uid, st.st_gid, AT_SYMLINK_NOFOLLOW);
+    utimensat(dfd, dname, times, AT_SYMLINK_NOFOLLOW);
+    return 0;
+}
+
+static void copy_file_batch(void *arg) {
+    FileBatch *batch = arg;
+    CopyJob *job = batch->job;
+
+    for (int i = 0; i < batch->count; i++) {
+        if (copy_entry_at(batch->dir->src_fd, batch->names[i],
+                          batch->dir->dst_fd, batch->names[i], job->preserve_owner) != 0) {
+            report_error(job, batch->relpath, batch->names[i], errno);
+        }
+        free(batch->names[i]);
+    }
+    free(batch->relpath);
+    dir_handle_release(batch->dir);
+    free(batch);
+}
+
+static void copy_dir_task(void *arg) {
+    DirTask *task = arg;
+    CopyJob *job = task->job;
+
+    int sfd = openat(job->src_root, task->relpath, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (sfd < 0) {
+        report_error(job, task->relpath, NULL, errno);
+        goto out;
+    }
+    int dfd = openat(job->dst_root, task->relpath, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dfd < 0) {
+        report_error(job, task->relpath, NULL, errno);
+        close(sfd);
+        goto out;
+    }
+
+    DirHandle *handle = malloc(sizeof(DirHandle));
+    char *buf = malloc(GETDENTS_BUF_SIZE);
+    if (!handle || !buf) {
+        report_error(job, task->relpath, NULL, ENOMEM);
+        free(handle);
+        free(buf);
+        close(sfd);
+        close(dfd);
+        goto out;
+    }
+    handle->src_fd = sfd;
+    handle->dst_fd = dfd;
+    atomic_init(&handle->refs, 1);
+
+    FileBatch *batch = NULL;
+    for (;;) {
+        long nread = syscall(SYS_getdents64, sfd, buf, GETDENTS_BUF_SIZE);
+        if (nread < 0) {
+            report_error(job, task->relpath, NULL, errno);
+            break;
+        }
+        if (nread == 0) break;
+
+        for (long off = 0; off < nread;) {
+            struct linux_dirent64 *d = (struct linux_dirent64 *)(buf + off);
+            off += d->d_reclen;
+
+            const char *name = d->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+
+            unsigned char type = d->d_type;
+            struct stat st;
+            if (type == DT_UNKNOWN || type == DT_DIR) {
+                if (fstatat(sfd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                    report_error(job, task->relpath, name, errno);
+                    continue;
+                }
+                type = IFTODT(st.st_mode);
+            }
+
+            if (type == DT_DIR) {
+                // Create owner-writable for now; real mode is applied in the fix-up pass
+                if (mkdirat(dfd, name, 0700) != 0) {
+                    report_error(job, task->relpath, name, errno);
+                    continue;
+                }
+                DirTask *child = malloc(sizeof(DirTask));
+                char *child_path = join_relpath(task->relpath, name);
+                if (!child || !child_path) {
+                    report_error(job, task->relpath, name, ENOMEM);
+                    free(child);
+                    free(child_path);
+                    continue;
+                }
+                record_dir(job, child_path, task->depth + 1, &st);
+                child->job = job;
+                child->relpath = child_path;
+                child->depth = task->depth + 1;
+                thread_pool_submit(job->pool, copy_dir_task, child);
+                continue;
+            }
+
+            if (!batch) {
+                batch = calloc(1, sizeof(FileBatch));
+                if (!batch) {
+                    report_error(job, task->relpath, name, ENOMEM);
+                    continue;
+                }
+                batch->job = job;
+                batch->dir = handle;
+                batch->relpath = strdup(task->relpath);
+                atomic_fetch_add(&handle->refs, 1);
+            }
+            batch->names[batch->count++] = strdup(name);
+            if (batch->count == FILE_BATCH) {
+                thread_pool_submit(job->pool, copy_file_batch, batch);
+                batch = NULL;
+            }
+        }
+    }
+    if (batch) {
+        thread_pool_submit(job->pool, copy_file_batch, batch);
+    }
+
+    free(buf);
+    dir_handle_release(handle);
+out:
+    free(task->relpath);
+    free(task);
+}
+
+static int compare_depth_desc(const void *a, const void *b) {
+    const DirMeta *da = a;
+    const DirMeta *db = b;
+    return db->depth - da->depth;
+}
+
+// Apply directory modes and times deepest-first, so creating children
+// no longer disturbs a parent's mtime and read-only dirs stay writable until the end
+static void fixup_directories(CopyJob *job) {
+    qsort(job->dirs, job->dir_count, sizeof(DirMeta), compare_depth_desc);
+    for (size_t i = 0; i < job->dir_count; i++) {
+        DirMeta *m = &job->dirs[i];
+        if (job->preserve_owner) fchownat(job->dst_root, m->relpath, m->uid, m->gid, 0);
+        if (fchmodat(job->dst_root, m->relpath, m->mode & 07777, 0) != 0 ||
+            utimensat(job->dst_root, m->relpath, m->times, 0) != 0) {
+            report_error(job, m->relpath, NULL, errno);
+        }
+        free(m->relpath);
+    }
+    free(job->dirs);
+}
+
+int tree_copy(const char *src, const char *dst) {
+    struct stat st;
+    if (lstat(src, &st) != 0) {
+        fprintf(stderr, "copy: %s: %s\n", src, strerror(errno));
+        return -1;
+    }
+
+    int preserve_owner = (geteuid() == 0);
+    if (!S_ISDIR(st.st_mode)) {
+        if (copy_entry_at(AT_FDCWD, src, AT_FDCWD, dst, preserve_owner) != 0) {
+            fprintf(stderr, "copy: %s: %s\n", src, strerror(errno));
+            return -1;
+        }
+        return 0;
+    }
+
+    if (mkdir(dst, 0700) != 0) {
+        fprintf(stderr, "copy: %s: %s\n", dst, strerror(errno));
+        return -1;
+    }
+
+    CopyJob job;
+    memset(&job, 0, sizeof(job));
+    job.preserve_owner = preserve_owner;
+    job.src_root = open(src, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    job.dst_root = open(dst, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (job.src_root < 0 || job.dst_root < 0) {
+        fprintf(stderr, "copy: %s: %s\n", job.src_root < 0 ? src : dst, strerror(errno));
+        if (job.src_root >= 0) close(job.src_root);
+        if (job.dst_root >= 0) close(job.dst_root);
+        return -1;
+    }
+    pthread_mutex_init(&job.lock, NULL);
+    atomic_init(&job.errors, 0);
+
+    job.pool = thread_pool_create(0, MAX_PENDING_TASKS);
+    record_dir(&job, ".", 0, &st);
+
+    DirTask *root = malloc(sizeof(DirTask));
+    root->job = &job;
+    root->relpath = strdup(".");
+    root->depth = 0;
+    if (job.pool) {
+        thread_pool_submit(job.pool, copy_dir_task, root);
+        thread_pool_wait(job.pool);
+        thread_pool_destroy(job.pool);
+    } else {
+        report_error(&job, src, NULL, ENOMEM);
+        free(root->relpath);
+        free(root);
+    }
+
+    fixup_directories(&job);
+    close(job.src_root);
+    close(job.dst_root);
+    pthread_mutex_destroy(&job.lock);
+
+    return atomic_load(&job.errors) == 0 ? 0 : -1;
+}
+
+static int remove_at(int dirfd, const char *name) {
+    if (unlinkat(dirfd, name, 0) == 0) return 0;
+    if (errno != EISDIR && errno != EPERM) return -1;
+
+    int fd = openat(dirfd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    char *buf = malloc(GETDENTS_BUF_SIZE);
+    if (!buf) {
+        close(fd);
+        return -1;
+    }
+
+    // Keep passing over the directory until a pass removes nothing, since
+    // unlinking while iterating may cause getdents64 to skip entries
+    int removed;
+    int rc = 0;
+    do {
+        removed = 0;
+        lseek(fd, 0, SEEK_SET);
+        long nread;
+        while ((nread = syscall(SYS_getdents64, fd, buf, GETDENTS_BUF_SIZE)) > 0) {
+            for (long off = 0; off < nread;) {
+                struct linux_dirent64 *d = (struct linux_dirent64 *)(buf + off);
+                off += d->d_reclen;
+                const char *child = d->d_name;
+                if (child[0] == '.' && (child[1] == '\0' || (child[1] == '.' && child[2] == '\0'))) {
+                    continue;
+                }
+                if (remove_at(fd, child) == 0) {
+                    removed++;
+                } else {
+                    rc = -1;
+                }
+            }
+        }
+    } while (removed > 0 && rc == 0);
+
+    free(buf);
+    close(fd);
+    if (rc != 0) return rc;
+    return unlinkat(dirfd, name, AT_REMOVEDIR);
+}
+
+int tree_remove(const char *path) {
+    return remove_at(AT_FDCWD, path);
+}
+
+int tree_move(const char *src, const char *dst) {
+    if (rename(src, dst) == 0) return 0;
+    if (errno != EXDEV) return -1;
+
+    // Different filesystem: copy everything, then drop the source
+    if (tree_copy(src, dst) != 0) {
+        int saved = errno;
+        tree_remove(dst);
+        errno = saved ? saved : EIO;
+        return -1;
+    }
+    return tree_remove(src);
+}
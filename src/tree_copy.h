@@ -0,0 +1,16 @@
+#ifndef TREE_COPY_H
+#define TREE_COPY_H
+
+// Copy a file or directory tree to dst (which must not exist yet).
+// Directories are walked in parallel and files are copied by a worker pool;
+// directory permissions and timestamps are fixed up once all contents exist.
+// Returns 0 on success, -1 if anything failed (errors are reported on stderr).
+int tree_copy(const char *src, const char *dst);
+
+// Rename src to dst, falling back to tree_copy + tree_remove across filesystems
+int tree_move(const char *src, const char *dst);
+
+// Recursively remove a file or directory tree without following symlinks
+int tree_remove(const char *path);
+
+#endif // TREE_COPY_H
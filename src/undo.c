@@ -1,4 +1,5 @@
 #include "undo.h"
+#include "tree_copy.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -197,7 +198,7 @@ int razz_undo(char **args) {
         char *orig_path = strtok(NULL, ":");
         char *trash_path = strtok(NULL, ":");
         if (orig_path && trash_path) {
-            if (rename(trash_path, orig_path) == 0) {
+            if (tree_move(trash_path, orig_path) == 0) {
                 printf("\033[1;32m✓ Restored file/directory to '%s'\033[0m\n", orig_path);
             } else {
                 perror("Undo delete failed");
@@ -207,7 +208,7 @@ int razz_undo(char **args) {
         char *orig_path = strtok(NULL, ":");
         char *dest_path = strtok(NULL, ":");
         if (orig_path && dest_path) {
-            if (rename(dest_path, orig_path) == 0) {
+            if (tree_move(dest_path, orig_path) == 0) {
                 printf("\033[1;32m✓ Moved back from '%s' to '%s'\033[0m\n", dest_path, orig_path);
             } else {
                 perror("Undo move failed");
@@ -216,7 +217,8 @@ int razz_undo(char **args) {
     } else if (strcmp(type, "COPY") == 0) {
         char *dest_path = strtok(NULL, ":");
         if (dest_path) {
-            if (remove_dir_recursive(dest_path) == 0) {
+            // Copied trees may contain symlinks, so never follow them while removing
+            if (tree_remove(dest_path) == 0) {
                 printf("\033[1;32m✓ Removed copied file/directory '%s'\033[0m\n", dest_path);
             } else {
                 perror("Undo copy failed");
@@ -424,11 +426,8 @@ int move_to_trash(const char *orig_path, char *trash_path_out) {
         return 0;
     }
     
-    // If rename failed (e.g. cross-device link), copy and remove
-    char cmd[PATH_MAX * 2 + 32];
-    snprintf(cmd, sizeof(cmd), "cp -r \"%s\" \"%s\" && rm -rf \"%s\"", abs_orig, trash_path_out, abs_orig);
-    int status = system(cmd);
-    if (status == 0) {
+    // If rename failed (e.g. cross-device link), copy the tree natively and remove it
+    if (tree_move(abs_orig, trash_path_out) == 0) {
         undo_log_delete(abs_orig, trash_path_out);
         return 0;
     }
@@ -0,0 +1,278 @@
+#define _GNU_SOURCE
+#include "word_count.h"
+#include "thread_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define CHUNK_SIZE     (8 * 1024 * 1024)
+#define READ_BUF_SIZE  (1024 * 1024)
+#define FILE_BATCH     256
+
+static inline int is_space_byte(unsigned char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+void word_count_buffer(const char *buf, size_t len, int prev_space, WordCounts *out) {
+    size_t lines = 0, words = 0, chars = 0;
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i nl = _mm_set1_epi8('\n');
+    const __m128i sp = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i four = _mm_set1_epi8(4);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i cont_limit = _mm_set1_epi8((char)0xC0);
+    unsigned carry = prev_space ? 1u : 0u;
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i b = _mm_loadu_si128((const __m128i *)(buf + i));
+
+        lines += (size_t)__builtin_popcount((unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(b, nl)));
+
+        // Whitespace is ' ' or 9..13: (b - 9) <= 4 unsigned
+        __m128i ctrl = _mm_cmpeq_epi8(_mm_subs_epu8(_mm_sub_epi8(b, tab), four), zero);
+        unsigned ws = (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(b, sp), ctrl));
+
+        // A word starts where a non-space byte follows a space byte
+        unsigned prev = ((ws << 1) | carry) & 0xFFFFu;
+        words += (size_t)__builtin_popcount(~ws & prev & 0xFFFFu);
+        carry = (ws >> 15) & 1u;
+
+        // Continuation bytes 0x80..0xBF are the signed values below (int8)0xC0
+        unsigned cont = (unsigned)_mm_movemask_epi8(_mm_cmplt_epi8(b, cont_limit));
+        chars += 16 - (size_t)__builtin_popcount(cont);
+    }
+    prev_space = (int)carry;
+#endif
+
+    for (; i < len; i++) {
+        unsigned char c = (unsigned char)buf[i];
+        if (c == '\n') lines++;
+        int space = is_space_byte(c);
+        if (!space && prev_space) words++;
+        prev_space = space;
+        if ((c & 0xC0) != 0x80) chars++;
+    }
+
+    out->lines += lines;
+    out->words += words;
+    out->bytes += len;
+    out->chars += chars;
+}
+
+// One slice of a mapped file
+typedef struct {
+    const char *base;
+    size_t offset;
+    size_t len;
+    WordCounts counts;
+} ChunkTask;
+
+typedef struct {
+    const char *name;
+    void *map;
+    size_t size;
+    ChunkTask *chunks;
+    size_t nchunks;
+    WordCounts counts;
+    int failed;
+} FileCount;
+
+static void count_chunk(void *arg) {
+    ChunkTask *c = arg;
+    int prev_space = (c->offset == 0) ? 1 : is_space_byte((unsigned char)c->base[c->offset - 1]);
+    word_count_buffer(c->base + c->offset, c->len, prev_space, &c->counts);
+}
+
+static int count_fd_stream(int fd, WordCounts *out) {
+    char *buf = malloc(READ_BUF_SIZE);
+    if (!buf) return -1;
+    int prev_space = 1;
+    ssize_t n;
+    while ((n = read(fd, buf, READ_BUF_SIZE)) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            free(buf);
+            return -1;
+        }
+        word_count_buffer(buf, (size_t)n, prev_space, out);
+        prev_space = is_space_byte((unsigned char)buf[n - 1]);
+    }
+    free(buf);
+    return 0;
+}
+
+// Map a file and queue its chunks; non-mappable inputs are counted inline
+static void prepare_file(ThreadPool *pool, FileCount *fc) {
+    int fd = open(fc->name, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "wordcount: %s: %s\n", fc->name, strerror(errno));
+        if (fd >= 0) close(fd);
+        fc->failed = 1;
+        return;
+    }
+    if (S_ISDIR(st.st_mode)) {
+        fprintf(stderr, "wordcount: %s: Is a directory\n", fc->name);
+        close(fd);
+        fc->failed = 1;
+        return;
+    }
+
+    if (!S_ISREG(st.st_mode) || st.st_size == 0) {
+        // Pipes, devices and procfs files report no usable size
+        if (count_fd_stream(fd, &fc->counts) != 0) {
+            fprintf(stderr, "wordcount: %s: %s\n", fc->name, strerror(errno));
+            fc->failed = 1;
+        }
+        close(fd);
+        return;
+    }
+
+    fc->size = (size_t)st.st_size;
+    fc->map = mmap(NULL, fc->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (fc->map == MAP_FAILED) {
+        fc->map = NULL;
+        if (count_fd_stream(fd, &fc->counts) != 0) fc->failed = 1;
+        close(fd);
+        return;
+    }
+    close(fd);
+    madvise(fc->map, fc->size, MADV_SEQUENTIAL);
+
+    fc->nchunks = (fc->size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    fc->chunks = calloc(fc->nchunks, sizeof(ChunkTask));
+    if (!fc->chunks) {
+        fc->nchunks = 0;
+        word_count_buffer(fc->map, fc->size, 1, &fc->counts);
+        return;
+    }
+    for (size_t i = 0; i < fc->nchunks; i++) {
+        ChunkTask *c = &fc->chunks[i];
+        c->base = fc->map;
+        c->offset = i * CHUNK_SIZE;
+        c->len = (i + 1 == fc->nchunks) ? fc->size - c->offset : CHUNK_SIZE;
+        if (pool) thread_pool_submit(pool, count_chunk, c);
+        else count_chunk(c);
+    }
+}
+
+static void merge_file(FileCount *fc) {
+    for (size_t i = 0; i < fc->nchunks; i++) {
+        fc->counts.lines += fc->chunks[i].counts.lines;
+        fc->counts.words += fc->chunks[i].counts.words;
+        fc->counts.bytes += fc->chunks[i].counts.bytes;
+        fc->counts.chars += fc->chunks[i].counts.chars;
+    }
+    free(fc->chunks);
+    fc->chunks = NULL;
+    if (fc->map) munmap(fc->map, fc->size);
+    fc->map = NULL;
+}
+
+typedef struct {
+    int lines;
+    int words;
+    int bytes;
+    int chars;
+} CountColumns;
+
+static void print_header(const CountColumns *cols) {
+    if (cols->lines) printf("%10s ", "LINES");
+    if (cols->words) printf("%10s ", "WORDS");
+    if (cols->chars) printf("%10s ", "CHARS");
+    if (cols->bytes) printf("%10s ", "BYTES");
+    printf("%s\n", "FILE");
+}
+
+static void print_row(const CountColumns *cols, const WordCounts *wc, const char *name) {
+    if (cols->lines) printf("%10zu ", wc->lines);
+    if (cols->words) printf("%10zu ", wc->words);
+    if (cols->chars) printf("%10zu ", wc->chars);
+    if (cols->bytes) printf("%10zu ", wc->bytes);
+    printf("%s\n", name);
+}
+
+int razz_wordcount(char **args) {
+    CountColumns cols = {0, 0, 0, 0};
+    int argi = 1;
+    for (; args[argi] && args[argi][0] == '-' && args[argi][1] != '\0'; argi++) {
+        for (const char *c = args[argi] + 1; *c; c++) {
+            switch (*c) {
+                case 'l': cols.lines = 1; break;
+                case 'w': cols.words = 1; break;
+                case 'c': cols.bytes = 1; break;
+                case 'm': cols.chars = 1; break;
+                default:
+                    fprintf(stderr, "wordcount: unknown option -%c\n", *c);
+                    fprintf(stderr, "Usage: wordcount [-l] [-w] [-c] [-m] [filename...]\n");
+                    return 1;
+            }
+        }
+    }
+    if (!cols.lines && !cols.words && !cols.bytes && !cols.chars) {
+        cols.lines = cols.words = cols.bytes = 1;
+    }
+
+    char **files = &args[argi];
+    int nfiles = 0;
+    while (files[nfiles]) nfiles++;
+
+    if (nfiles == 0) {
+        if (isatty(STDIN_FILENO)) {
+            printf("Usage: wordcount [-l] [-w] [-c] [-m] [filename...]\n");
+            return 1;
+        }
+        // Pipeline stage: count stdin
+        WordCounts wc = {0, 0, 0, 0};
+        if (count_fd_stream(STDIN_FILENO, &wc) != 0) {
+            perror("wordcount");
+            return 1;
+        }
+        print_header(&cols);
+        print_row(&cols, &wc, "-");
+        return 1;
+    }
+
+    ThreadPool *pool = thread_pool_create(0, 1024);
+    WordCounts total = {0, 0, 0, 0};
+    print_header(&cols);
+
+    // Files are counted in batches so mappings and results stay bounded
+    for (int start = 0; start < nfiles; start += FILE_BATCH) {
+        int count = nfiles - start < FILE_BATCH ? nfiles - start : FILE_BATCH;
+        FileCount *batch = calloc((size_t)count, sizeof(FileCount));
+        if (!batch) break;
+        for (int i = 0; i < count; i++) {
+            batch[i].name = files[start + i];
+            prepare_file(pool, &batch[i]);
+        }
+        if (pool) thread_pool_wait(pool);
+        for (int i = 0; i < count; i++) {
+            merge_file(&batch[i]);
+            if (batch[i].failed) continue;
+            print_row(&cols, &batch[i].counts, batch[i].name);
+            total.lines += batch[i].counts.lines;
+            total.words += batch[i].counts.words;
+            total.bytes += batch[i].counts.bytes;
+            total.chars += batch[i].counts.chars;
+        }
+        free(batch);
+    }
+    if (pool) thread_pool_destroy(pool);
+
+    if (nfiles > 1) {
+        print_row(&cols, &total, "total");
+    }
+    return 1;
+}
@@ -0,0 +1,22 @@
+#ifndef WORD_COUNT_H
+#define WORD_COUNT_H
+
+#include <stddef.h>
+
+// Line/word/byte/character totals for a span of text
+typedef struct {
+    size_t lines;
+    size_t words;
+    size_t bytes;
+    size_t chars;   // UTF-8 code points
+} WordCounts;
+
+// Count a buffer. prev_space says whether the byte before buf was
+// whitespace (1 at the start of input), so chunks can be counted independently.
+void word_count_buffer(const char *buf, size_t len, int prev_space, WordCounts *out);
+
+// Command: wordcount (wc)
+// wordcount [-l] [-w] [-c] [-m] [file...]; reads stdin when no file is given
+int razz_wordcount(char **args);
+
+#endif // WORD_COUNT_H